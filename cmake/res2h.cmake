@@ -0,0 +1,163 @@
+# Convert resources to a static library using res2h
+#
+# res2h_add_resources(<target> <input>
+#                     [RECURSE] [C] [REGISTER]
+#                     [OUTPUT_DIR <directory>]
+#                     [HEADER <file name>]
+#                     [UTILITIES <file name>]
+#                     [MODE hex|string|elf|asm]
+#                     [OPTIONS <res2h options>...])
+#
+# Converts the file or all files in the directory <input> and adds them to the static library <target>.
+# Every file gets its own custom command and output file, so touching one file only converts and compiles
+# that file again. The common header and utilities file are written by another command that runs when files
+# are changed, added or removed, but their content only changes if names or sizes change.
+# Link <target> and include HEADER to access the resources.
+#
+# RECURSE     Recurse into subdirectories of <input>.
+# C           Write C instead of C++ files.
+# REGISTER    Pass --register, so every file puts an entry into the "res2h_entries" linker section, and create
+#             an OBJECT library instead, so all entries are linked. Find resources using res2hregistry.h/.c.
+#             Needs CMake 3.12 to link the OBJECT library using target_link_libraries().
+# OUTPUT_DIR  Directory to write the files to. Defaults to ${CMAKE_CURRENT_BINARY_DIR}/<target>.
+# HEADER      Name of the common header. Defaults to "resources.h".
+# UTILITIES   Name of the utilities file. Defaults to "resources.c" / "resources.cpp".
+# MODE        How to store the data (see res2h -m). "asm" needs enable_language(ASM).
+# OPTIONS     Other options passed to res2h, e.g. --align 16 or --compress. -1, -b, -a, --manifest
+#             and --shard-size are not supported.
+#
+# The res2h target is used if it exists, else res2h is searched using find_program(). Set RES2H_EXECUTABLE
+# to use a specific executable.
+
+include(CMakeParseArguments)
+
+function(res2h_add_resources target input)
+	cmake_parse_arguments(RES2H "RECURSE;C;REGISTER" "OUTPUT_DIR;HEADER;UTILITIES;MODE" "OPTIONS" ${ARGN})
+	get_filename_component(input ${input} ABSOLUTE)
+	if (NOT RES2H_OUTPUT_DIR)
+		set(RES2H_OUTPUT_DIR ${CMAKE_CURRENT_BINARY_DIR}/${target})
+	endif()
+	get_filename_component(RES2H_OUTPUT_DIR ${RES2H_OUTPUT_DIR} ABSOLUTE)
+	if (RES2H_C)
+		set(source_extension ".c")
+		list(APPEND RES2H_OPTIONS -c)
+	else()
+		set(source_extension ".cpp")
+	endif()
+	if (NOT RES2H_HEADER)
+		set(RES2H_HEADER "resources.h")
+	endif()
+	if (NOT RES2H_UTILITIES)
+		set(RES2H_UTILITIES "resources${source_extension}")
+	endif()
+	set(header ${RES2H_OUTPUT_DIR}/${RES2H_HEADER})
+	set(utilities ${RES2H_OUTPUT_DIR}/${RES2H_UTILITIES})
+	# output file extension depends on the mode
+	if (NOT RES2H_MODE)
+		set(RES2H_MODE "hex")
+	endif()
+	if (RES2H_MODE STREQUAL "elf")
+		set(extension ".o")
+	elseif (RES2H_MODE STREQUAL "asm")
+		set(extension ".S")
+	else()
+		set(extension ${source_extension})
+	endif()
+	list(APPEND RES2H_OPTIONS -m ${RES2H_MODE})
+	# entries of unreferenced object files in a static library would not be linked
+	set(library_type STATIC)
+	if (RES2H_REGISTER)
+		list(APPEND RES2H_OPTIONS --register)
+		set(library_type OBJECT)
+	endif()
+	# find res2h. if it is built in this project, make sure commands run again when it changes
+	if (TARGET res2h)
+		set(res2h_command res2h)
+		set(res2h_depends res2h)
+	elseif (RES2H_EXECUTABLE)
+		set(res2h_command ${RES2H_EXECUTABLE})
+	else()
+		find_program(RES2H_EXECUTABLE res2h)
+		if (NOT RES2H_EXECUTABLE)
+			message(FATAL_ERROR "res2h_add_resources: res2h executable not found. Set RES2H_EXECUTABLE")
+		endif()
+		set(res2h_command ${RES2H_EXECUTABLE})
+	endif()
+	# collect input files. re-run CMake when files are added or removed
+	if (IS_DIRECTORY ${input})
+		set(glob_options "")
+		if (NOT CMAKE_VERSION VERSION_LESS 3.12)
+			set(glob_options CONFIGURE_DEPENDS)
+		endif()
+		if (RES2H_RECURSE)
+			file(GLOB_RECURSE files LIST_DIRECTORIES false ${glob_options} ${input}/*)
+			set(recurse_option -r)
+		else()
+			file(GLOB files LIST_DIRECTORIES false ${glob_options} ${input}/*)
+			set(recurse_option "")
+		endif()
+	else()
+		set(files ${input})
+	endif()
+	# add a command per file. output names are built like res2h does for directories
+	set(outputs "")
+	foreach(file ${files})
+		get_filename_component(name ${file} NAME)
+		string(REPLACE "." "_" name ${name})
+		if (IS_DIRECTORY ${input})
+			file(RELATIVE_PATH relative_path ${input} ${file})
+			get_filename_component(sub_dir ${relative_path} DIRECTORY)
+			if (sub_dir MATCHES "/")
+				string(REPLACE "/" "_" sub_dir ${sub_dir})
+				set(name "${sub_dir}_${name}")
+			elseif (sub_dir)
+				set(name "${sub_dir}__${name}")
+			endif()
+		endif()
+		set(output ${RES2H_OUTPUT_DIR}/${name}${extension})
+		# use the same internal name the header command uses
+		set(name_option "")
+		if (IS_DIRECTORY ${input})
+			set(name_option --name :/${relative_path})
+		endif()
+		add_custom_command(
+			OUTPUT ${output}
+			COMMAND ${CMAKE_COMMAND} -E make_directory ${RES2H_OUTPUT_DIR}
+			COMMAND ${res2h_command} ${file} ${output} ${RES2H_OPTIONS} ${name_option} -h ${header} --data-only
+			DEPENDS ${file} ${res2h_depends}
+			COMMENT "Converting resource ${file}"
+			VERBATIM
+		)
+		list(APPEND outputs ${output})
+	endforeach()
+	if (IS_DIRECTORY ${input})
+		set(declarations_output ${RES2H_OUTPUT_DIR})
+	else()
+		set(declarations_output ${outputs})
+	endif()
+	# add command for the common header and utilities. the depfile lists all files and directories
+	set(depfile ${RES2H_OUTPUT_DIR}/${target}.d)
+	set(depfile_option "")
+	if (NOT CMAKE_VERSION VERSION_LESS 3.20 AND CMAKE_GENERATOR MATCHES "Ninja|Makefiles")
+		set(depfile_option DEPFILE ${depfile})
+	endif()
+	cmake_policy(PUSH)
+	if (POLICY CMP0116)
+		cmake_policy(SET CMP0116 NEW)
+	endif()
+	add_custom_command(
+		OUTPUT ${header} ${utilities}
+		COMMAND ${CMAKE_COMMAND} -E make_directory ${RES2H_OUTPUT_DIR}
+		COMMAND ${res2h_command} ${input} ${declarations_output} ${recurse_option} ${RES2H_OPTIONS} -h ${header} -u ${utilities} --no-data --depfile ${depfile}
+		DEPENDS ${files} ${res2h_depends}
+		${depfile_option}
+		COMMENT "Creating resource header ${header}"
+		VERBATIM
+	)
+	cmake_policy(POP)
+	if (RES2H_MODE STREQUAL "elf")
+		set_source_files_properties(${outputs} PROPERTIES EXTERNAL_OBJECT TRUE GENERATED TRUE)
+	endif()
+	add_library(${target} ${library_type} ${header} ${utilities} ${outputs})
+	target_include_directories(${target} PUBLIC ${RES2H_OUTPUT_DIR})
+endfunction()
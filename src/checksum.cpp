@@ -1,5 +1,9 @@
 #include "checksum.h"
 
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
 template <>
 uint16_t calculateFletcher(const uint8_t *data, uint16_t dataSize, uint16_t checksum)
 {
@@ -83,3 +87,146 @@ uint64_t calculateFletcher(const uint8_t *data, uint64_t dataSize, uint64_t chec
     }
     return (static_cast<uint64_t>(sum2) << 32) | sum1;
 }
+
+template <typename T>
+FletcherStream<T>::FletcherStream(uint64_t offset)
+    : m_size(offset)
+{
+    // the words before offset are zero, so they don't change the sums
+}
+
+template <typename T>
+void FletcherStream<T>::update(const uint8_t *data, uint64_t size)
+{
+    auto pendingSize = static_cast<std::size_t>(m_size % sizeof(Word));
+    m_size += size;
+    T checksum = (static_cast<T>(m_sum2) << (sizeof(Word) * 8)) | m_sum1;
+    // complete the word left over from the last block first
+    if (pendingSize > 0)
+    {
+        const auto count = static_cast<std::size_t>(std::min(static_cast<uint64_t>(sizeof(Word) - pendingSize), size));
+        std::memcpy(m_pending.data() + pendingSize, data, count);
+        data += count;
+        size -= count;
+        if (pendingSize + count < sizeof(Word))
+        {
+            return;
+        }
+        checksum = calculateFletcher<T>(m_pending.data(), sizeof(Word), checksum);
+        m_pending.fill(0);
+    }
+    // calculateFletcher() takes the size as T, so pass big blocks in pieces that are a multiple of the word size
+    const uint64_t wordBytes = size - size % sizeof(Word);
+    const uint64_t maxPieceSize = 1ULL << 30;
+    for (uint64_t offset = 0; offset < wordBytes;)
+    {
+        const auto pieceSize = std::min(wordBytes - offset, maxPieceSize);
+        checksum = calculateFletcher<T>(data + offset, static_cast<T>(pieceSize), checksum);
+        offset += pieceSize;
+    }
+    std::memcpy(m_pending.data(), data + wordBytes, static_cast<std::size_t>(size - wordBytes));
+    m_sum1 = static_cast<Word>(checksum);
+    m_sum2 = static_cast<Word>(checksum >> (sizeof(Word) * 8));
+}
+
+template <typename T>
+void FletcherStream<T>::addPrefix(const uint8_t *data, uint64_t size)
+{
+    // the checksum is linear in the words, so the prefix words can be added on their own. every word passed after the
+    // prefix adds the running sum to sum2 once, so add the prefix sum to sum2 once for every word already passed.
+    // if the last prefix word is the pending word, its count is one less, which the pending word adds in checksum()
+    const T prefix = calculateFletcher<T>(data, static_cast<T>(size));
+    const auto prefixSum1 = static_cast<Word>(prefix);
+    const auto prefixSum2 = static_cast<Word>(prefix >> (sizeof(Word) * 8));
+    const uint64_t prefixWords = (size + sizeof(Word) - 1) / sizeof(Word);
+    const uint64_t words = m_size / sizeof(Word);
+    m_sum1 = static_cast<Word>(m_sum1 + prefixSum1);
+    m_sum2 = static_cast<Word>(m_sum2 + prefixSum2 + (words - prefixWords) * static_cast<uint64_t>(prefixSum1));
+}
+
+template <typename T>
+void FletcherStream<T>::add(const FletcherStream &other)
+{
+    // extend both checksums with zero words to the same length. this adds sum1 to sum2 once for every added word
+    const uint64_t words = (m_size + sizeof(Word) - 1) / sizeof(Word);
+    const uint64_t otherWords = (other.m_size + sizeof(Word) - 1) / sizeof(Word);
+    const uint64_t allWords = std::max(words, otherWords);
+    const T checksum = this->checksum();
+    const T otherChecksum = other.checksum();
+    const auto sum1 = static_cast<Word>(checksum);
+    const auto otherSum1 = static_cast<Word>(otherChecksum);
+    Word allSum1 = static_cast<Word>(sum1 + otherSum1);
+    Word allSum2 = static_cast<Word>(static_cast<Word>(checksum >> (sizeof(Word) * 8)) + (allWords - words) * static_cast<uint64_t>(sum1) +
+                                     static_cast<Word>(otherChecksum >> (sizeof(Word) * 8)) + (allWords - otherWords) * static_cast<uint64_t>(otherSum1));
+    // keep a partial last word pending, so more data can follow. both streams may have bytes in it
+    std::array<uint8_t, sizeof(Word)> pending{};
+    const std::array<const FletcherStream *, 2> streams = {this, &other};
+    for (const auto stream : streams)
+    {
+        if (stream->m_size % sizeof(Word) != 0 && (stream->m_size + sizeof(Word) - 1) / sizeof(Word) == allWords)
+        {
+            for (std::size_t index = 0; index < pending.size(); ++index)
+            {
+                pending[index] = static_cast<uint8_t>(pending[index] | stream->m_pending[index]);
+            }
+        }
+    }
+    m_size = std::max(m_size, other.m_size);
+    m_pending = pending;
+    if (m_size % sizeof(Word) != 0)
+    {
+        // remove the pending word from the sums. checksum() adds it again
+        Word pendingWord = 0;
+        std::memcpy(&pendingWord, pending.data(), sizeof(Word));
+        allSum2 = static_cast<Word>(allSum2 - allSum1);
+        allSum1 = static_cast<Word>(allSum1 - pendingWord);
+    }
+    m_sum1 = allSum1;
+    m_sum2 = allSum2;
+}
+
+template <typename T>
+T FletcherStream<T>::checksum() const
+{
+    const T checksum = (static_cast<T>(m_sum2) << (sizeof(Word) * 8)) | m_sum1;
+    // calculateFletcher() pads a partial word at the end with zeros
+    return m_size % sizeof(Word) != 0 ? calculateFletcher<T>(m_pending.data(), sizeof(Word), checksum) : checksum;
+}
+
+template class FletcherStream<uint32_t>;
+template class FletcherStream<uint64_t>;
+
+uint64_t calculateFNV1a64(const uint8_t *data, uint64_t dataSize, uint64_t hash)
+{
+    static const uint64_t prime = 0x100000001b3ULL;
+    if (data != nullptr)
+    {
+        for (uint64_t index = 0; index < dataSize; ++index)
+        {
+            hash = (hash ^ data[index]) * prime;
+        }
+    }
+    return hash;
+}
+
+uint64_t calculateFNV1a64(const std::string &filePath)
+{
+    std::ifstream inStream;
+    inStream.open(filePath, std::ios_base::in | std::ios_base::binary);
+    if (!inStream.is_open() || !inStream.good())
+    {
+        throw std::runtime_error("Failed to open file " + filePath + " for reading");
+    }
+    uint64_t hash = FNV1A64_OFFSET_BASIS;
+    std::array<char, 64 * 1024> buffer{};
+    while (inStream.good())
+    {
+        inStream.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        hash = calculateFNV1a64(reinterpret_cast<const uint8_t *>(buffer.data()), static_cast<uint64_t>(inStream.gcount()), hash);
+    }
+    if (!inStream.eof())
+    {
+        throw std::runtime_error("Failed to read from file " + filePath);
+    }
+    return hash;
+}
@@ -4,6 +4,7 @@
 #include <cstdint>
 #include <fstream>
 #include <string>
+#include <type_traits>
 
 /// @brief Create Fletcher checksum from data.
 /// @param[in] data Data to create checksum for.
@@ -14,14 +15,65 @@
 template <typename T>
 T calculateFletcher(const uint8_t *data, T dataSize, T checksum = 0);
 
+/// @brief Calculates a Fletcher checksum of data passed in blocks of any size, e.g. while copying it.
+/// The result is the same as calculateFletcher() on all data at once, which needs blocks that are a multiple of the word size.
+/// Data may start at an offset. The bytes before are treated as zero, so they can be filled in later using addPrefix().
+/// Only uint32_t (Fletcher32) and uint64_t (Fletcher64) are supported.
+template <typename T>
+class FletcherStream
+{
+  public:
+    /// @brief Start checksumming data at offset. The data before offset is zero until addPrefix() is called.
+    explicit FletcherStream(uint64_t offset = 0);
+
+    /// @brief Add the next size bytes of data to the checksum.
+    void update(const uint8_t *data, uint64_t size);
+
+    /// @brief Add the first size bytes of the data, which were treated as zero. They may be passed at any time.
+    /// Use this for headers that can only be written after all following data is known.
+    void addPrefix(const uint8_t *data, uint64_t size);
+
+    /// @brief Add the checksum of other, which covers other bytes of the same data, e.g. a block checksummed on another thread.
+    /// Construct other with the offset of its bytes in the data. The result is the checksum of the bytes of both streams.
+    void add(const FletcherStream &other);
+
+    /// @brief Return the checksum of all data passed so far.
+    T checksum() const;
+
+  private:
+    using Word = typename std::conditional<sizeof(T) == 8, uint32_t, uint16_t>::type;
+    Word m_sum1 = 0;
+    Word m_sum2 = 0;
+    uint64_t m_size = 0; // !<Number of bytes passed including the offset.
+    std::array<uint8_t, sizeof(Word)> m_pending{}; // !<Bytes of the current word if it is not complete yet.
+};
+
+/// @brief Offset basis of the 64bit FNV-1a hash. Use as initial value for calculateFNV1a64.
+const uint64_t FNV1A64_OFFSET_BASIS = 0xcbf29ce484222325ULL;
+
+/// @brief Create 64bit FNV-1a hash from data.
+/// @param[in] data Data to create hash for.
+/// @param[in] dataSize The size of the data to incorporate in the hash.
+/// @param[in] hash Optional. Hash from last run if you're hashing data in multiple blocks.
+/// @return Returns the FNV-1a hash of the data.
+/// @note Based on this: https://en.wikipedia.org/wiki/Fowler%E2%80%93Noll%E2%80%93Vo_hash_function.
+uint64_t calculateFNV1a64(const uint8_t *data, uint64_t dataSize, uint64_t hash = FNV1A64_OFFSET_BASIS);
+
+/// @brief Create 64bit FNV-1a hash from the whole content of a file.
+/// @param[in] filePath Path to the file to build the hash for.
+/// @return Returns the FNV-1a hash of the file content.
+/// @throw std::runtime_error if the file can't be opened or read.
+uint64_t calculateFNV1a64(const std::string &filePath);
+
 /// @brief Create Fletcher checksum from file. Builds checksum from start position till EOF.
 /// @param[in] filePath Path to the file to build the checksum for.
 /// @param[in] dataSize Optional. The size of the data to incorporate in the checksum. Pass 0 to scan whole file.
 /// @param[in] checksum Optional. Adler checksum from last run if you're using more than one file.
+/// @param[in] startOffset Optional. Position in the file to start at, e.g. the start of an archive appended to an executable.
 /// @return Returns the Fletcher checksum for the file stream or the initial checksum upon failure.
 /// @note Based on this: https://en.wikipedia.org/wiki/Fletcher's_checksum.
 template <typename T>
-T calculateFletcher(const std::string &filePath, T dataSize = 0, T checksum = 0)
+T calculateFletcher(const std::string &filePath, T dataSize = 0, T checksum = 0, uint64_t startOffset = 0)
 {
     // open file
     std::ifstream inStream;
@@ -30,6 +82,7 @@ T calculateFletcher(const std::string &filePath, T dataSize = 0, T checksum = 0)
     {
         throw std::runtime_error("Failed to open file for reading");
     }
+    inStream.seekg(static_cast<std::streamoff>(startOffset));
     // loop until EOF or dataSize reached
     T rollingSize = 0;
     std::array<uint8_t, 4096> buffer{};
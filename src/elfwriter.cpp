@@ -0,0 +1,297 @@
+#include "elfwriter.h"
+
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+#include <vector>
+
+// ELF constants from the System V ABI. See e.g. https://refspecs.linuxfoundation.org/elf/gabi4+/contents.html
+static const uint8_t ELFCLASS32 = 1;
+static const uint8_t ELFCLASS64 = 2;
+static const uint8_t ELFDATA2LSB = 1;
+static const uint8_t EV_CURRENT = 1;
+static const uint16_t ET_REL = 1;
+static const uint32_t SHT_PROGBITS = 1;
+static const uint32_t SHT_SYMTAB = 2;
+static const uint32_t SHT_STRTAB = 3;
+static const uint64_t SHF_ALLOC = 2;
+static const uint8_t STB_GLOBAL = 1;
+static const uint8_t STT_OBJECT = 1;
+
+// Sections in the order they are written to the object file
+enum SectionIndex : uint16_t
+{
+    SectionNull = 0,
+    SectionRodata,
+    SectionNoteGnuStack,
+    SectionSymtab,
+    SectionStrtab,
+    SectionShstrtab,
+    NrOfSections
+};
+
+// The size symbol is at the start of the data section, the data follows at this offset at the earliest
+static const uint64_t rodataAlignment = 8;
+
+/// @brief Helper to write little-endian values of arbitrary size to a stream.
+class LittleEndianWriter
+{
+  public:
+    explicit LittleEndianWriter(std::ostream &outStream)
+        : m_outStream(outStream)
+    {
+    }
+
+    void write(uint64_t value, uint32_t nrOfBytes)
+    {
+        if (nrOfBytes > sizeof(uint64_t))
+        {
+            throw std::runtime_error("Values can have at most 8 bytes");
+        }
+        std::array<char, 8> bytes{};
+        for (uint32_t i = 0; i < nrOfBytes; ++i)
+        {
+            bytes[i] = static_cast<char>((value >> (8 * i)) & 0xFF);
+        }
+        m_outStream.write(bytes.data(), nrOfBytes);
+        m_position += nrOfBytes;
+    }
+
+    void write(const std::string &data)
+    {
+        m_outStream.write(data.data(), static_cast<std::streamsize>(data.size()));
+        m_position += data.size();
+    }
+
+    void writeZeros(uint64_t nrOfBytes)
+    {
+        for (uint64_t i = 0; i < nrOfBytes; ++i)
+        {
+            write(0, 1);
+        }
+    }
+
+    void padTo(uint64_t position)
+    {
+        if (m_position < position)
+        {
+            writeZeros(position - m_position);
+        }
+    }
+
+    void copy(std::istream &inStream, uint64_t size)
+    {
+        std::vector<char> buffer(256 * 1024);
+        uint64_t bytesCopied = 0;
+        while (bytesCopied < size && inStream.good())
+        {
+            inStream.read(buffer.data(), static_cast<std::streamsize>(std::min(static_cast<uint64_t>(buffer.size()), size - bytesCopied)));
+            const auto readSize = inStream.gcount();
+            m_outStream.write(buffer.data(), readSize);
+            bytesCopied += static_cast<uint64_t>(readSize);
+        }
+        if (bytesCopied != size)
+        {
+            throw std::runtime_error("Failed to read all data from input");
+        }
+        m_position += size;
+    }
+
+  private:
+    std::ostream &m_outStream;
+    uint64_t m_position = 0;
+};
+
+static uint64_t alignTo(uint64_t value, uint64_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+ElfTarget hostElfTarget()
+{
+    ElfTarget target;
+#if defined(__x86_64__) || defined(_M_X64)
+    target.machine = 62; // EM_X86_64
+#if defined(__ILP32__)
+    target.is64Bit = false; // x32 ABI
+#endif
+#elif defined(__i386__) || defined(_M_IX86)
+    target.machine = 3; // EM_386
+    target.is64Bit = false;
+#elif defined(__aarch64__) && defined(__AARCH64EL__)
+    target.machine = 183; // EM_AARCH64
+#elif defined(__arm__) && defined(__ARMEL__)
+    target.machine = 40; // EM_ARM
+    target.is64Bit = false;
+    // EABI version 5 and the floating point calling convention, so the linker does not complain about mismatches
+#if defined(__ARM_PCS_VFP)
+    target.flags = 0x05000000 | 0x400; // EF_ARM_EABI_VER5 | EF_ARM_ABI_FLOAT_HARD
+#else
+    target.flags = 0x05000000 | 0x200; // EF_ARM_EABI_VER5 | EF_ARM_ABI_FLOAT_SOFT
+#endif
+#elif defined(__riscv) && (__riscv_xlen == 32 || __riscv_xlen == 64)
+    target.machine = 243; // EM_RISCV
+    target.is64Bit = __riscv_xlen == 64;
+#if defined(__riscv_compressed)
+    target.flags |= 0x1; // EF_RISCV_RVC
+#endif
+#if defined(__riscv_float_abi_double)
+    target.flags |= 0x4; // EF_RISCV_FLOAT_ABI_DOUBLE
+#elif defined(__riscv_float_abi_single)
+    target.flags |= 0x2; // EF_RISCV_FLOAT_ABI_SINGLE
+#endif
+#elif defined(__powerpc64__) && defined(__LITTLE_ENDIAN__)
+    target.machine = 21; // EM_PPC64
+    target.flags = 2; // ELFv2 ABI
+#else
+    throw std::runtime_error("ELF object output is not supported on this machine");
+#endif
+    return target;
+}
+
+void writeElfObject(std::ostream &outStream, std::istream &inStream, uint64_t dataSize, uint32_t sizeBytes, const std::string &dataSymbol, const std::string &sizeSymbol, uint64_t dataAlignment, const std::string &sectionName, const ElfTarget &target)
+{
+    if (sizeBytes != 2 && sizeBytes != 4 && sizeBytes != 8)
+    {
+        throw std::runtime_error("Size symbol must have 2, 4 or 8 bytes");
+    }
+    if (dataAlignment == 0 || (dataAlignment & (dataAlignment - 1)) != 0)
+    {
+        throw std::runtime_error("Data alignment must be a power of two");
+    }
+    // the data follows the size symbol at the requested alignment, the section needs the same alignment
+    const uint64_t sectionAlignment = std::max(rodataAlignment, dataAlignment);
+    const uint64_t dataOffset = sectionAlignment;
+    // sizes of structures and addresses depend on the ELF class
+    const uint32_t addressBytes = target.is64Bit ? 8 : 4;
+    const uint64_t headerSize = target.is64Bit ? 64 : 52;
+    const uint64_t sectionHeaderSize = target.is64Bit ? 64 : 40;
+    const uint64_t symbolSize = target.is64Bit ? 24 : 16;
+    // string tables. index 0 must be the empty string
+    const std::string strtab = std::string(1, '\0') + sizeSymbol + '\0' + dataSymbol + '\0';
+    const uint32_t sizeSymbolName = 1;
+    const auto dataSymbolName = static_cast<uint32_t>(sizeSymbolName + sizeSymbol.size() + 1);
+    std::string shstrtab(1, '\0');
+    std::array<uint32_t, NrOfSections> sectionNames{};
+    const std::array<std::string, NrOfSections> names = {"", sectionName, ".note.GNU-stack", ".symtab", ".strtab", ".shstrtab"};
+    for (uint16_t index = SectionRodata; index < NrOfSections; ++index)
+    {
+        sectionNames[index] = static_cast<uint32_t>(shstrtab.size());
+        shstrtab += names[index] + '\0';
+    }
+    // symbol table: null symbol, size symbol, data symbol. all symbols after the null symbol are global
+    const uint64_t nrOfSymbols = 3;
+    const uint32_t firstGlobalSymbol = 1;
+    // calculate section layout
+    std::array<uint64_t, NrOfSections> offsets{};
+    std::array<uint64_t, NrOfSections> sizes{};
+    offsets[SectionRodata] = alignTo(headerSize, sectionAlignment);
+    sizes[SectionRodata] = dataOffset + dataSize;
+    offsets[SectionNoteGnuStack] = offsets[SectionRodata] + sizes[SectionRodata];
+    offsets[SectionSymtab] = alignTo(offsets[SectionNoteGnuStack], addressBytes);
+    sizes[SectionSymtab] = nrOfSymbols * symbolSize;
+    offsets[SectionStrtab] = offsets[SectionSymtab] + sizes[SectionSymtab];
+    sizes[SectionStrtab] = strtab.size();
+    offsets[SectionShstrtab] = offsets[SectionStrtab] + sizes[SectionStrtab];
+    sizes[SectionShstrtab] = shstrtab.size();
+    const uint64_t sectionHeaderOffset = alignTo(offsets[SectionShstrtab] + sizes[SectionShstrtab], addressBytes);
+    if (!target.is64Bit && sectionHeaderOffset + NrOfSections * sectionHeaderSize > UINT32_MAX)
+    {
+        throw std::runtime_error("Data is too big for a 32bit ELF object");
+    }
+    LittleEndianWriter writer(outStream);
+    // ELF header. identification first
+    writer.write(0x7F, 1);
+    writer.write("ELF");
+    writer.write(target.is64Bit ? ELFCLASS64 : ELFCLASS32, 1);
+    writer.write(ELFDATA2LSB, 1);
+    writer.write(EV_CURRENT, 1);
+    writer.padTo(16); // OS ABI, ABI version and padding are 0
+    writer.write(ET_REL, 2);
+    writer.write(target.machine, 2);
+    writer.write(EV_CURRENT, 4);
+    writer.write(0, addressBytes); // entry point
+    writer.write(0, addressBytes); // program header offset
+    writer.write(sectionHeaderOffset, addressBytes);
+    writer.write(target.flags, 4);
+    writer.write(headerSize, 2);
+    writer.write(0, 2); // program header entry size
+    writer.write(0, 2); // number of program headers
+    writer.write(sectionHeaderSize, 2);
+    writer.write(NrOfSections, 2);
+    writer.write(SectionShstrtab, 2);
+    // data section with size and data. .note.GNU-stack is empty and marks the stack as non-executable
+    writer.padTo(offsets[SectionRodata]);
+    writer.write(dataSize, sizeBytes);
+    writer.padTo(offsets[SectionRodata] + dataOffset);
+    writer.copy(inStream, dataSize);
+    // symbol table
+    writer.padTo(offsets[SectionSymtab]);
+    writer.writeZeros(symbolSize);
+    const uint8_t symbolInfo = (STB_GLOBAL << 4) | STT_OBJECT;
+    const std::array<std::array<uint64_t, 3>, 2> symbols = {{{sizeSymbolName, 0, sizeBytes}, {dataSymbolName, dataOffset, dataSize}}};
+    for (const auto &symbol : symbols)
+    {
+        if (target.is64Bit)
+        {
+            writer.write(symbol[0], 4); // name
+            writer.write(symbolInfo, 1);
+            writer.write(0, 1); // visibility
+            writer.write(SectionRodata, 2);
+            writer.write(symbol[1], 8); // value
+            writer.write(symbol[2], 8); // size
+        }
+        else
+        {
+            writer.write(symbol[0], 4); // name
+            writer.write(symbol[1], 4); // value
+            writer.write(symbol[2], 4); // size
+            writer.write(symbolInfo, 1);
+            writer.write(0, 1); // visibility
+            writer.write(SectionRodata, 2);
+        }
+    }
+    // string tables
+    writer.write(strtab);
+    writer.write(shstrtab);
+    // section headers. the first one is all zeros
+    writer.padTo(sectionHeaderOffset);
+    writer.writeZeros(sectionHeaderSize);
+    for (uint16_t index = SectionRodata; index < NrOfSections; ++index)
+    {
+        uint32_t type = SHT_STRTAB;
+        uint64_t flags = 0;
+        uint32_t link = 0;
+        uint32_t info = 0;
+        uint64_t alignment = 1;
+        uint64_t entrySize = 0;
+        if (index == SectionRodata)
+        {
+            type = SHT_PROGBITS;
+            flags = SHF_ALLOC;
+            alignment = sectionAlignment;
+        }
+        else if (index == SectionNoteGnuStack)
+        {
+            type = SHT_PROGBITS;
+        }
+        else if (index == SectionSymtab)
+        {
+            type = SHT_SYMTAB;
+            link = SectionStrtab;
+            info = firstGlobalSymbol;
+            alignment = addressBytes;
+            entrySize = symbolSize;
+        }
+        writer.write(sectionNames[index], 4);
+        writer.write(type, 4);
+        writer.write(flags, addressBytes);
+        writer.write(0, addressBytes); // address
+        writer.write(offsets[index], addressBytes);
+        writer.write(sizes[index], addressBytes);
+        writer.write(link, 4);
+        writer.write(info, 4);
+        writer.write(alignment, addressBytes);
+        writer.write(entrySize, addressBytes);
+    }
+}
@@ -0,0 +1,34 @@
+// Write relocatable ELF object files containing resource data
+#pragma once
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+
+/// @brief Target machine information needed for relocatable ELF object files.
+/// Only little-endian targets are supported.
+struct ElfTarget
+{
+    uint16_t machine = 0; // !<ELF machine type (e_machine), e.g. EM_X86_64.
+    uint32_t flags = 0; // !<Processor-specific flags (e_flags), e.g. the ARM EABI version.
+    bool is64Bit = true; // !<True for ELFCLASS64, false for ELFCLASS32 objects.
+};
+
+/// @brief Return the ELF target of the machine res2h was compiled for.
+/// @throw std::runtime_error if the host machine is not supported.
+ElfTarget hostElfTarget();
+
+/// @brief Write a relocatable ELF object file to outStream. The object has a read-only data section holding
+/// a global symbol sizeSymbol with the size of the data, followed by a global symbol dataSymbol with the data.
+/// @param outStream Stream to write the object file to. Should have been opened in binary mode.
+/// @param inStream Stream to read the data from.
+/// @param dataSize Number of bytes to read from inStream.
+/// @param sizeBytes Size of the size symbol in bytes (2, 4 or 8) so it matches the type declared in the common header.
+/// @param dataSymbol Name of the data symbol.
+/// @param sizeSymbol Name of the size symbol.
+/// @param dataAlignment Alignment of the data symbol in bytes. Must be a power of two.
+/// @param sectionName Name of the data section, e.g. ".rodata".
+/// @param target Target machine for object file.
+/// @throw std::runtime_error if the alignment is invalid or the data can't be read completely or does not fit into the object file.
+void writeElfObject(std::ostream &outStream, std::istream &inStream, uint64_t dataSize, uint32_t sizeBytes, const std::string &dataSymbol, const std::string &sizeSymbol, uint64_t dataAlignment, const std::string &sectionName, const ElfTarget &target);
@@ -0,0 +1,174 @@
+#include "lz4.h"
+
+#include <cstring>
+#include <stdexcept>
+
+// LZ4 block format constants. See https://github.com/lz4/lz4/blob/dev/doc/lz4_Block_format.md
+static const uint64_t MIN_MATCH = 4; // minimum length of a match
+static const uint64_t LAST_LITERALS = 5; // the last bytes of a block are always literals
+static const uint64_t MATCH_FIND_LIMIT = 12; // the last match must start at least this many bytes before the end of the block
+static const uint64_t MAX_OFFSET = 65535; // matches are referenced by a 16bit offset
+static const uint32_t HASH_BITS = 16;
+
+static uint32_t read32(const uint8_t *data)
+{
+    uint32_t value = 0;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+static uint32_t hash32(uint32_t value)
+{
+    // Knuth's multiplicative hash
+    return (value * 2654435761U) >> (32 - HASH_BITS);
+}
+
+/// @brief Append a length that does not fit into the 4 bits of the token as a sequence of bytes.
+static void writeLength(std::vector<uint8_t> &result, uint64_t length)
+{
+    for (; length >= 255; length -= 255)
+    {
+        result.push_back(255);
+    }
+    result.push_back(static_cast<uint8_t>(length));
+}
+
+/// @brief Append a sequence of literals followed by a match. A matchLength of 0 means there is no match.
+static void writeSequence(std::vector<uint8_t> &result, const uint8_t *literals, uint64_t literalLength, uint64_t offset, uint64_t matchLength)
+{
+    const uint64_t matchCode = matchLength > 0 ? matchLength - MIN_MATCH : 0;
+    const auto token = static_cast<uint8_t>(((literalLength < 15 ? literalLength : 15) << 4) | (matchCode < 15 ? matchCode : 15));
+    result.push_back(token);
+    if (literalLength >= 15)
+    {
+        writeLength(result, literalLength - 15);
+    }
+    result.insert(result.end(), literals, literals + literalLength);
+    if (matchLength > 0)
+    {
+        result.push_back(static_cast<uint8_t>(offset & 0xFF));
+        result.push_back(static_cast<uint8_t>(offset >> 8));
+        if (matchCode >= 15)
+        {
+            writeLength(result, matchCode - 15);
+        }
+    }
+}
+
+std::vector<uint8_t> compressLZ4(const uint8_t *data, uint64_t dataSize)
+{
+    std::vector<uint8_t> result;
+    result.reserve(static_cast<std::size_t>(dataSize + dataSize / 255 + 16));
+    uint64_t anchor = 0;
+    if (dataSize > MATCH_FIND_LIMIT)
+    {
+        // greedy parsing. the hash table stores the last position a 4 byte sequence was seen at
+        std::vector<uint64_t> table(1 << HASH_BITS, 0);
+        const uint64_t matchFindEnd = dataSize - MATCH_FIND_LIMIT;
+        const uint64_t matchEnd = dataSize - LAST_LITERALS;
+        uint64_t position = 1;
+        table[hash32(read32(data))] = 0;
+        while (position <= matchFindEnd)
+        {
+            const uint32_t sequence = read32(data + position);
+            auto &entry = table[hash32(sequence)];
+            const uint64_t reference = entry;
+            entry = position;
+            if (reference >= position || position - reference > MAX_OFFSET || read32(data + reference) != sequence)
+            {
+                ++position;
+                continue;
+            }
+            // extend match backwards over literals and forwards as far as allowed
+            uint64_t start = position;
+            uint64_t matchStart = reference;
+            while (start > anchor && matchStart > 0 && data[start - 1] == data[matchStart - 1])
+            {
+                --start;
+                --matchStart;
+            }
+            uint64_t end = position + MIN_MATCH;
+            while (end < matchEnd && data[end] == data[reference + (end - position)])
+            {
+                ++end;
+            }
+            writeSequence(result, data + anchor, start - anchor, start - matchStart, end - start);
+            anchor = end;
+            position = end;
+        }
+    }
+    // the last sequence only has literals
+    writeSequence(result, data + anchor, dataSize - anchor, 0, 0);
+    return result;
+}
+
+std::vector<uint8_t> decompressLZ4(const uint8_t *data, uint64_t dataSize, uint64_t decompressedSize)
+{
+    std::vector<uint8_t> result;
+    result.reserve(static_cast<std::size_t>(decompressedSize));
+    uint64_t position = 0;
+    // read a length that does not fit into the 4 bits of the token
+    auto readLength = [&](uint64_t length) {
+        uint8_t extra = 255;
+        while (extra == 255)
+        {
+            if (position >= dataSize)
+            {
+                throw std::runtime_error("Unexpected end of compressed data");
+            }
+            extra = data[position++];
+            length += extra;
+        }
+        return length;
+    };
+    while (position < dataSize)
+    {
+        // token holds the number of literals in the high and the match length in the low nibble
+        const uint8_t token = data[position++];
+        uint64_t length = token >> 4;
+        if (length == 15)
+        {
+            length = readLength(length);
+        }
+        if (length > dataSize - position || length > decompressedSize - result.size())
+        {
+            throw std::runtime_error("Literals exceed data size");
+        }
+        result.insert(result.end(), data + position, data + position + length);
+        position += length;
+        // the last sequence only has literals
+        if (position == dataSize)
+        {
+            break;
+        }
+        if (dataSize - position < 2)
+        {
+            throw std::runtime_error("Unexpected end of compressed data");
+        }
+        const uint64_t offset = data[position] | (static_cast<uint64_t>(data[position + 1]) << 8);
+        position += 2;
+        if (offset == 0 || offset > result.size())
+        {
+            throw std::runtime_error("Invalid match offset");
+        }
+        length = (token & 15U) + MIN_MATCH;
+        if ((token & 15U) == 15)
+        {
+            length = readLength(length);
+        }
+        if (length > decompressedSize - result.size())
+        {
+            throw std::runtime_error("Match exceeds data size");
+        }
+        // copy byte by byte, because source and destination may overlap
+        for (uint64_t index = result.size() - offset; length > 0; --length, ++index)
+        {
+            result.push_back(result[static_cast<std::size_t>(index)]);
+        }
+    }
+    if (result.size() != decompressedSize)
+    {
+        throw std::runtime_error("Decompressed data has the wrong size");
+    }
+    return result;
+}
@@ -0,0 +1,20 @@
+// Fast compression of resource data using the LZ4 block format
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+/// @brief Compress data to an LZ4 block. The result can be decompressed by any LZ4 block decoder, e.g. LZ4_decompress_safe().
+/// @param[in] data Data to compress.
+/// @param[in] dataSize The size of the data in bytes.
+/// @return Returns the compressed data. Incompressible data gets slightly bigger (at most dataSize / 255 + 16 bytes).
+/// @note Format description: https://github.com/lz4/lz4/blob/dev/doc/lz4_Block_format.md.
+std::vector<uint8_t> compressLZ4(const uint8_t *data, uint64_t dataSize);
+
+/// @brief Decompress an LZ4 block.
+/// @param[in] data Compressed data.
+/// @param[in] dataSize The size of the compressed data in bytes.
+/// @param[in] decompressedSize The size of the data after decompression in bytes.
+/// @return Returns the decompressed data.
+/// @throw std::runtime_error if the data is not a valid LZ4 block or does not decompress to decompressedSize bytes.
+std::vector<uint8_t> decompressLZ4(const uint8_t *data, uint64_t dataSize, uint64_t decompressedSize);
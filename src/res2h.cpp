@@ -1,35 +1,113 @@
 #include "res2h.h"
 #include "checksum.h"
+#include "res2hconvert.h"
 #include "res2hhelpers.h"
+#include "res2hmanifest.h"
+#include "res2hstats.h"
+#include "res2htransform.h"
 #include "stdfs.h"
 #include "stdfshelpers.h"
-#include "syshelpers.h"
 
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstring>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <iterator>
+#include <map>
+#include <numeric>
+#include <set>
+#include <sstream>
 #include <string>
+#include <thread>
 #include <vector>
 
+#if defined(__linux__)
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <csignal>
+#endif
+
 static bool beVerbose = false;
 static bool useRecursion = false;
 static bool useC = false;
 static bool createBinary = false;
 static bool appendFile = false;
 static bool combineResults = false;
+static bool deduplicate = false;
+static bool useSections = false; // put every data array into its own linker section
+static bool compressData = false; // store data LZ4-compressed and decompress it on first use
+static bool dataOnly = false; // only write data files, not the common header and utilities
+static bool noData = false; // only write the common header and utilities, not the data files
+static bool printStatistics = false; // print time and throughput of phases and the slowest files at the end
+static bool registerEntries = false; // put an entry for every file into the "res2h_entries" linker section
+static bool watchForChanges = false; // keep running and update outputs when input files change
+static uint32_t nrOfThreads = 1;
+static uint64_t shardSize = 0; // maximum number of data bytes per output file. 0 means no limit
+static uint64_t hybridThreshold = 0; // files bigger than this go to hybridArchivePath if it is not empty
+static stdfs::path hybridArchivePath; // archive files bigger than hybridThreshold are stored in instead of data arrays
+static uint64_t dataAlignment = 0; // alignment of data arrays or archive entry data in bytes. 0 means the default alignment of the compiler or no padding
+static OutputMode outputMode = OutputMode::Hex;
 static stdfs::path commonHeaderFilePath;
 static stdfs::path utilitiesFilePath;
 static stdfs::path inFilePath;
 static stdfs::path outFilePath;
-static std::ofstream badOfStream; // we need this later as a default parameter...
-static const std::string indent = "    ";
+static stdfs::path manifestFilePath;
+static stdfs::path depfilePath;
+static std::string internalNameOption; // internal name of a single input file. empty means the file name is used
+static TransformMap fileTransforms; // transforms applied to the content of input files by extension
+static stdfs::path statsJsonPath; // file time and throughput are written to as JSON if not empty
+static Stats statistics; // time spent on phases and files. always collected, only reported if requested
+static const std::size_t statsNrOfSlowestFiles = 10; // number of files reported by --stats
+
+/// @brief Return the options set on the command line that influence how files are converted.
+static ConvertOptions convertOptions()
+{
+    ConvertOptions options;
+    options.outputMode = outputMode;
+    options.useC = useC;
+    options.useSections = useSections;
+    options.compressData = compressData;
+    options.registerEntries = registerEntries;
+    options.shardSize = shardSize;
+    options.dataAlignment = dataAlignment;
+    options.beVerbose = beVerbose;
+    return options;
+}
+
+/// @brief Return the extension of files data is converted to depending on output mode.
+static std::string outputFileExtension()
+{
+    switch (outputMode)
+    {
+        case OutputMode::Elf: return ".o";
+        case OutputMode::Asm: return ".S";
+        default: return useC ? ".c" : ".cpp";
+    }
+}
 
-/// @brief Macro to do / print something if verbose output is on. Yes, this should probably be a template...
-#define IF_BEVERBOSE(a)         \
-    {                           \
-        if (beVerbose) { (a); } \
+/// @brief Return all options that influence the content of converted files for the manifest.
+static std::string manifestOptions()
+{
+    static const std::array<const char *, 4> modeNames = {"hex", "string", "elf", "asm"};
+    std::ostringstream options;
+    options << "version=" << RES2H_VERSION_STRING << " mode=" << modeNames.at(static_cast<std::size_t>(outputMode)) << " c=" << useC << " header=" << commonHeaderFilePath.generic_string() << " shard=" << shardSize << " align=" << dataAlignment << " sections=" << useSections << " compress=" << compressData << " register=" << registerEntries << " hybrid=" << (hybridArchivePath.empty() ? 0 : hybridThreshold);
+    for (const auto &transforms : fileTransforms)
+    {
+        for (const auto &transform : transforms.second)
+        {
+            options << " transform=" << transforms.first << ":" << transform.name;
+        }
     }
+    return options.str();
+}
 
 static void printVersion()
 {
@@ -40,26 +118,75 @@ static void printVersion()
 static void printUsage()
 {
     std::cout << "Usage: res2h INFILE/INDIR OUTFILE/OUTDIR [OPTIONS]" << std::endl;
+    std::cout << "INFILE can be \"-\" or a pipe to convert data from stdin / the pipe while reading it." << std::endl;
     std::cout << "Valid OPTIONS:" << std::endl;
     std::cout << "-r Recurse into subdirectories below indir." << std::endl;
     std::cout << "-c Use .c files and C-arrays for storing the data definitions, else" << std::endl;
     std::cout << "   uses .cpp files and std::vector/std::map." << std::endl;
     std::cout << "-h HEADERFILE Puts all declarations in a common \"HEADERFILE\" using \"extern\"" << std::endl;
     std::cout << "   and includes that header file in the source files." << std::endl;
+    std::cout << "   With -b HEADERFILE gets the IDs of all resources for Res2h::loadResource()." << std::endl;
     std::cout << "-u SOURCEFILE Create utility functions and arrays in a .c/.cpp file." << std::endl;
     std::cout << "   Only makes sense in combination with -h" << std::endl;
     std::cout << "-1 Combine all converted files into one big .c/.cpp file (use with -u)." << std::endl;
     std::cout << "-b Compile binary archive outfile containing all infile(s). For reading in your" << std::endl;
     std::cout << "   software include res2hinterface.h/.cpp and consult the docs." << std::endl;
     std::cout << "-a Append infile to outfile. Can be used to append an archive to an executable." << std::endl;
+    std::cout << "-j N Scan directories, convert files and read archive input using N threads in parallel (default 1)." << std::endl;
+    std::cout << "-m MODE How to store data in .c/.cpp files. MODE can be \"hex\" for hex array" << std::endl;
+    std::cout << "   initializers (default) or \"string\" for string literals, which compile faster." << std::endl;
+    std::cout << "   \"elf\" writes .o ELF object files for the host machine, \"asm\" writes .S assembler" << std::endl;
+    std::cout << "   files using .incbin. Both bypass the C/C++ compiler. Header and utilities stay .c/.cpp." << std::endl;
+    std::cout << "--shard-size BYTES Put at most BYTES of data (K, M or G suffixes allowed) into one .c/.cpp file." << std::endl;
+    std::cout << "   Larger files are split into chunks and a segment table. With -1 the data is" << std::endl;
+    std::cout << "   written to multiple files next to SOURCEFILE. Needs -h." << std::endl;
+    std::cout << "--hybrid BYTES ARCHIVE Store files bigger than BYTES (K, M or G suffixes allowed) in the binary archive" << std::endl;
+    std::cout << "   ARCHIVE instead of .cpp files. Append it to your executable using -a. res2hGetData() returns" << std::endl;
+    std::cout << "   embedded data or loads it from the archive using Res2h. C++ only. Needs -h and -u." << std::endl;
+    std::cout << "--transform EXT NAME Transform the content of files with extension EXT before converting them. NAME can be" << std::endl;
+    std::cout << "   \"minify-whitespace\", \"trim-zeros\", \"strip-png\" or \"cmd:COMMAND\" to pipe the data through COMMAND." << std::endl;
+    std::cout << "   Pass multiple times to chain transforms. Sizes and checksums are those of the transformed data." << std::endl;
+    std::cout << "--dedup Store the data of files with the same content only once." << std::endl;
+    std::cout << "--align N Align data arrays or the data of archive entries to N bytes. N must be a power of two <= 65536." << std::endl;
+    std::cout << "--sections Put every data array into its own \".rodata.res2h.NAME\" section on ELF targets," << std::endl;
+    std::cout << "   so unreferenced data can be removed when linking with \"-Wl,--gc-sections\"." << std::endl;
+    std::cout << "--register Put an entry for every file into the \"res2h_entries\" linker section on ELF targets." << std::endl;
+    std::cout << "   Link res2hregistry.h/.c to find all linked-in resources without generating -u." << std::endl;
+    std::cout << "--compress Store data LZ4-compressed. res2hGetData() decompresses it on first use. Needs -h and -u." << std::endl;
+    std::cout << "--manifest FILE Store size, modification time and hash of input files in FILE." << std::endl;
+    std::cout << "   Files that did not change since the last run with the same FILE are not converted again." << std::endl;
+    std::cout << "--depfile FILE Write a Make / Ninja depfile listing all input files and directories to FILE." << std::endl;
+    std::cout << "--name NAME Use NAME as internal name of a single input file instead of its file name, e.g. \":/dir/a.x\"." << std::endl;
+    std::cout << "--data-only Only write data files. The header from -h is included, but not written." << std::endl;
+    std::cout << "--no-data Only write the common header and utilities file. Needs -h." << std::endl;
+    std::cout << "--watch Keep running after converting and update outputs when files in INDIR change. Only new and" << std::endl;
+    std::cout << "   changed files are converted again. Stop with Ctrl+C. Linux only." << std::endl;
+    std::cout << "--stats Print wall time, bytes processed and MB/s for every phase and the 10 slowest files." << std::endl;
+    std::cout << "--stats-json FILE Write the same statistics as JSON to FILE." << std::endl;
     std::cout << "-v Be verbose." << std::endl;
     std::cout << "Examples:" << std::endl;
     std::cout << "res2h ./lenna.png ./resources/lenna_png.cpp (convert single file)" << std::endl;
     std::cout << "res2h ./data ./resources -s -h resources.h -u resources.cpp (convert directory)" << std::endl;
+    std::cout << "generator | res2h - ./resources/generated_bin.cpp (convert data from stdin)" << std::endl;
     std::cout << "res2h ./data ./resources/data.bin -b (convert directory to binary file)" << std::endl;
     std::cout << "res2h ./resources/data.bin ./program.exe -a (append archive to executable)" << std::endl;
 }
 
+/// @brief Parse a number of bytes >= 1 with an optional K, M or G suffix for kilo-, mega- and gigabytes.
+/// @throw std::logic_error if text is not a valid size.
+static uint64_t parseByteSize(const std::string &text)
+{
+    std::size_t suffixPos = 0;
+    const uint64_t size = std::stoull(text, &suffixPos);
+    const std::string suffix = text.substr(suffixPos);
+    const uint32_t shift = suffix.empty() ? 0 : (suffix == "K" ? 10 : (suffix == "M" ? 20 : (suffix == "G" ? 30 : 64)));
+    if (size < 1 || shift >= 64 || size > (UINT64_MAX >> shift))
+    {
+        throw std::out_of_range("Invalid size");
+    }
+    return size << shift;
+}
+
 static bool readArguments(const std::vector<std::string> &arguments)
 {
     bool pastFiles = false;
@@ -105,9 +232,9 @@ static bool readArguments(const std::vector<std::string> &arguments)
         }
         else if (argument == "-b")
         {
-            if (!commonHeaderFilePath.empty() || !utilitiesFilePath.empty())
+            if (!utilitiesFilePath.empty())
             {
-                std::cerr << "Option -b can not be combined with -h or -u" << std::endl;
+                std::cerr << "Option -b can not be combined with -u" << std::endl;
                 return false;
             }
             if (appendFile)
@@ -138,13 +265,272 @@ static bool readArguments(const std::vector<std::string> &arguments)
             beVerbose = true;
             pastFiles = true;
         }
-        else if (argument == "-h")
+        else if (argument == "-j")
         {
-            if (createBinary)
+            // try getting next argument as number of threads
+            if (++aIt != arguments.cend())
+            {
+                try
+                {
+                    const auto value = std::stoul(*aIt);
+                    if (value < 1 || value > UINT16_MAX)
+                    {
+                        throw std::out_of_range("Invalid number of threads");
+                    }
+                    nrOfThreads = static_cast<uint32_t>(value);
+                }
+                catch (const std::logic_error & /*e*/)
+                {
+                    std::cerr << "Option -j needs a number of threads >= 1, but \"" << *aIt << "\" was passed" << std::endl;
+                    return false;
+                }
+            }
+            else
+            {
+                std::cerr << "Option -j specified, but no number of threads found" << std::endl;
+                return false;
+            }
+            pastFiles = true;
+        }
+        else if (argument == "-m")
+        {
+            // try getting next argument as output mode
+            if (++aIt != arguments.cend())
+            {
+                if (*aIt == "hex")
+                {
+                    outputMode = OutputMode::Hex;
+                }
+                else if (*aIt == "string")
+                {
+                    outputMode = OutputMode::String;
+                }
+                else if (*aIt == "elf")
+                {
+                    outputMode = OutputMode::Elf;
+                }
+                else if (*aIt == "asm")
+                {
+                    outputMode = OutputMode::Asm;
+                }
+                else
+                {
+                    std::cerr << "Unknown output mode \"" << *aIt << "\" for option -m" << std::endl;
+                    return false;
+                }
+            }
+            else
+            {
+                std::cerr << "Option -m specified, but no output mode found" << std::endl;
+                return false;
+            }
+            pastFiles = true;
+        }
+        else if (argument == "--shard-size")
+        {
+            // try getting next argument as maximum number of bytes per output file
+            if (++aIt != arguments.cend())
+            {
+                try
+                {
+                    shardSize = parseByteSize(*aIt);
+                }
+                catch (const std::logic_error & /*e*/)
+                {
+                    std::cerr << "Option --shard-size needs a number of bytes >= 1 with an optional K, M or G suffix, but \"" << *aIt << "\" was passed" << std::endl;
+                    return false;
+                }
+            }
+            else
+            {
+                std::cerr << "Option --shard-size specified, but no size found" << std::endl;
+                return false;
+            }
+            pastFiles = true;
+        }
+        else if (argument == "--hybrid")
+        {
+            // try getting next arguments as threshold and archive file name
+            if (++aIt != arguments.cend())
+            {
+                try
+                {
+                    hybridThreshold = parseByteSize(*aIt);
+                }
+                catch (const std::logic_error & /*e*/)
+                {
+                    std::cerr << "Option --hybrid needs a number of bytes >= 1 with an optional K, M or G suffix, but \"" << *aIt << "\" was passed" << std::endl;
+                    return false;
+                }
+            }
+            if (aIt == arguments.cend() || ++aIt == arguments.cend())
+            {
+                std::cerr << "Option --hybrid specified, but no size or archive file name found" << std::endl;
+                return false;
+            }
+            hybridArchivePath = naiveLexicallyNormal(stdfs::path(*aIt));
+            if (hybridArchivePath.empty())
+            {
+                return false;
+            }
+            pastFiles = true;
+        }
+        else if (argument == "--transform")
+        {
+            // try getting next arguments as extension and transform name
+            if (++aIt == arguments.cend() || aIt->empty() || (aIt + 1) == arguments.cend())
+            {
+                std::cerr << "Option --transform specified, but no extension or transform found" << std::endl;
+                return false;
+            }
+            const auto extension = normalizeTransformExtension(*aIt);
+            try
+            {
+                fileTransforms[extension].push_back(createTransform(*++aIt));
+            }
+            catch (const std::runtime_error &e)
+            {
+                std::cerr << "Invalid transform for option --transform: " << e.what() << std::endl;
+                return false;
+            }
+            pastFiles = true;
+        }
+        else if (argument == "--dedup")
+        {
+            deduplicate = true;
+            pastFiles = true;
+        }
+        else if (argument == "--align")
+        {
+            // try getting next argument as alignment in bytes
+            if (++aIt != arguments.cend())
+            {
+                try
+                {
+                    dataAlignment = std::stoull(*aIt);
+                    if (dataAlignment < 1 || dataAlignment > 65536 || (dataAlignment & (dataAlignment - 1)) != 0)
+                    {
+                        throw std::out_of_range("Invalid alignment");
+                    }
+                }
+                catch (const std::logic_error & /*e*/)
+                {
+                    std::cerr << "Option --align needs a power of two <= 65536, but \"" << *aIt << "\" was passed" << std::endl;
+                    return false;
+                }
+            }
+            else
+            {
+                std::cerr << "Option --align specified, but no alignment found" << std::endl;
+                return false;
+            }
+            pastFiles = true;
+        }
+        else if (argument == "--sections")
+        {
+            useSections = true;
+            pastFiles = true;
+        }
+        else if (argument == "--register")
+        {
+            registerEntries = true;
+            pastFiles = true;
+        }
+        else if (argument == "--compress")
+        {
+            compressData = true;
+            pastFiles = true;
+        }
+        else if (argument == "--data-only")
+        {
+            dataOnly = true;
+            pastFiles = true;
+        }
+        else if (argument == "--no-data")
+        {
+            noData = true;
+            pastFiles = true;
+        }
+        else if (argument == "--depfile")
+        {
+            // try getting next argument as depfile name
+            if (++aIt != arguments.cend())
+            {
+                depfilePath = naiveLexicallyNormal(stdfs::path(*aIt));
+                if (depfilePath.empty())
+                {
+                    return false;
+                }
+            }
+            else
+            {
+                std::cerr << "Option --depfile specified, but no file name found" << std::endl;
+                return false;
+            }
+            pastFiles = true;
+        }
+        else if (argument == "--name")
+        {
+            // try getting next argument as internal name
+            if (++aIt != arguments.cend() && !aIt->empty())
+            {
+                internalNameOption = *aIt;
+            }
+            else
+            {
+                std::cerr << "Option --name specified, but no name found" << std::endl;
+                return false;
+            }
+            pastFiles = true;
+        }
+        else if (argument == "--watch")
+        {
+            watchForChanges = true;
+            pastFiles = true;
+        }
+        else if (argument == "--stats")
+        {
+            printStatistics = true;
+            pastFiles = true;
+        }
+        else if (argument == "--stats-json")
+        {
+            // try getting next argument as statistics file name
+            if (++aIt != arguments.cend())
+            {
+                statsJsonPath = naiveLexicallyNormal(stdfs::path(*aIt));
+                if (statsJsonPath.empty())
+                {
+                    return false;
+                }
+            }
+            else
+            {
+                std::cerr << "Option --stats-json specified, but no file name found" << std::endl;
+                return false;
+            }
+            pastFiles = true;
+        }
+        else if (argument == "--manifest")
+        {
+            // try getting next argument as manifest file name
+            if (++aIt != arguments.cend())
+            {
+                manifestFilePath = naiveLexicallyNormal(stdfs::path(*aIt));
+                if (manifestFilePath.empty())
+                {
+                    return false;
+                }
+            }
+            else
             {
-                std::cerr << "Option -h can not be combined with -b" << std::endl;
+                std::cerr << "Option --manifest specified, but no file name found" << std::endl;
                 return false;
             }
+            pastFiles = true;
+        }
+        else if (argument == "-h")
+        {
             if (appendFile)
             {
                 std::cerr << "Option -h can not be combined with -a" << std::endl;
@@ -204,7 +590,8 @@ static bool readArguments(const std::vector<std::string> &arguments)
             // if no files/directories have been found yet this is probably a file/directory
             if (inFilePath.empty())
             {
-                inFilePath = naiveLexicallyNormal(stdfs::path(argument));
+                // "-" means stdin and is not a path
+                inFilePath = argument == stdinPath ? stdinPath : naiveLexicallyNormal(stdfs::path(argument));
                 if (inFilePath.empty())
                 {
                     return false;
@@ -226,166 +613,521 @@ static bool readArguments(const std::vector<std::string> &arguments)
             return false;
         }
     }
-    return true;
-}
-
-static bool convertFile(FileData &fileData, const stdfs::path &commonHeaderPath, std::ofstream &outStream = badOfStream, bool addHeader = true)
-{
-    if (!stdfs::exists(fileData.inPath))
+    if (deduplicate && (createBinary || appendFile))
     {
-        std::cerr << "File \"" << fileData.inPath.string() << "\" does not exist" << std::endl;
+        std::cerr << "Option --dedup can not be combined with -b or -a" << std::endl;
         return false;
     }
-    // try to open the input file
-    std::ifstream inStream;
-    inStream.open(fileData.inPath.string(), std::ios_base::in | std::ios_base::binary);
-    if (!inStream.is_open() || !inStream.good())
+    if (dataAlignment > 0 && appendFile)
     {
-        std::cerr << "Failed to open file \"" << fileData.inPath.string() << "\" for reading" << std::endl;
+        std::cerr << "Option --align can not be combined with -a" << std::endl;
         return false;
     }
-    IF_BEVERBOSE(std::cout << "Converting input file " << fileData.inPath)
-    // try getting size of data
-    inStream.seekg(0, std::ios::end);
-    fileData.size = static_cast<uint64_t>(inStream.tellg());
-    inStream.seekg(0);
-    // check if the caller passed an output stream and use that
-    bool closeOutStream = false;
-    if (!outStream.is_open() || !outStream.good())
+    if (useSections && (createBinary || appendFile))
     {
-        if (!fileData.outPath.empty())
-        {
-            // try opening the output stream. truncate it when it exists
-            outStream.open(fileData.outPath.string(), std::ofstream::out | std::ofstream::trunc);
-        }
-        else
-        {
-            std::cerr << "No output stream passed, but output path for \"" << fileData.inPath.filename().string() << "\" is empty! Skipping." << std::endl;
-            return false;
-        }
-        closeOutStream = true;
+        std::cerr << "Option --sections can not be combined with -b or -a" << std::endl;
+        return false;
     }
-    if (!outStream.is_open() || !outStream.good())
+    if (!manifestFilePath.empty() && (createBinary || appendFile))
     {
-        std::cerr << "Failed to open file \"" << fileData.outPath.string() << "\" for writing" << std::endl;
+        std::cerr << "Option --manifest can not be combined with -b or -a" << std::endl;
         return false;
     }
-    // check if caller wants to add a header
-    if (addHeader)
+    if (shardSize > 0 && (createBinary || appendFile || outputMode == OutputMode::Elf || outputMode == OutputMode::Asm))
     {
-        // add message
-        outStream << "// this file was auto-generated from \"" << fileData.inPath.filename().string() << "\" by res2h at " << currentDateAndTime() << std::endl
-                  << std::endl;
-        // add header include
-        if (!commonHeaderPath.empty())
-        {
-            // common header path must be relative to destination directory
-            stdfs::path relativeHeaderPath = naiveRelative(commonHeaderPath, fileData.outPath);
-            outStream << "#include \"" << relativeHeaderPath.generic_string() << "\"" << std::endl
-                      << std::endl;
-        }
+        std::cerr << "Option --shard-size can not be combined with -b, -a, -m elf or -m asm" << std::endl;
+        return false;
     }
-    // create names for variables
-    fileData.dataVariableName = fileData.outPath.filename().stem().string() + "_data";
-    fileData.sizeVariableName = fileData.outPath.filename().stem().string() + "_size";
-    // add size and data variable
-    if (fileData.size <= UINT16_MAX)
+    if (shardSize > 0 && commonHeaderFilePath.empty())
     {
-        outStream << "const uint16_t ";
+        std::cerr << "Option --shard-size has to be combined with -h" << std::endl;
+        return false;
     }
-    else if (fileData.size <= UINT32_MAX)
+    if (compressData && (createBinary || appendFile || outputMode == OutputMode::Elf || outputMode == OutputMode::Asm || shardSize > 0))
     {
-        outStream << "const uint32_t ";
+        std::cerr << "Option --compress can not be combined with -b, -a, -m elf, -m asm or --shard-size" << std::endl;
+        return false;
     }
-    else
+    if (registerEntries && (createBinary || appendFile || outputMode == OutputMode::Elf || outputMode == OutputMode::Asm || compressData || shardSize > 0 || deduplicate))
     {
-        outStream << "const uint64_t ";
+        std::cerr << "Option --register can not be combined with -b, -a, -m elf, -m asm, --compress, --shard-size or --dedup" << std::endl;
+        return false;
     }
-    outStream << fileData.sizeVariableName << " = " << std::dec << fileData.size << ";" << std::endl;
-    outStream << "const uint8_t " << fileData.dataVariableName << "[" << std::dec << fileData.size << "] = {" << std::endl;
-    outStream << indent; // first indent
-    // now add content
-    uint64_t breakCounter = 0;
-    while (!inStream.eof())
+    if (!hybridArchivePath.empty() && (createBinary || appendFile || useC || compressData || shardSize > 0 || deduplicate || registerEntries || dataOnly || noData))
     {
-        // read byte from source
-        unsigned char dataByte;
-        inStream.read(reinterpret_cast<char *>(&dataByte), 1);
-        // check if we have actually read something
-        if (inStream.gcount() != 1 || inStream.eof())
-        {
-            // we failed to read. break the read loop and close the file.
-            break;
-        }
-        // write to destination in hex with a width of 2 and '0' as padding. we do not use showbase, as it doesn't work with zero values
-        outStream << "0x" << std::setw(2) << std::setfill('0') << std::hex << static_cast<unsigned int>(dataByte);
-        // was this the last character?
-        if (!inStream.eof() && fileData.size > static_cast<uint64_t>(inStream.tellg()))
-        {
-            // no. add comma.
-            outStream << ",";
-            // add break after 14 bytes and add indent again
-            if (++breakCounter % 14 == 0)
-            {
-                outStream << std::endl
-                          << indent;
-            }
-        }
+        std::cerr << "Option --hybrid can not be combined with -b, -a, -c, --compress, --shard-size, --dedup, --register, --data-only or --no-data" << std::endl;
+        return false;
     }
-    // add closing curly braces
-    outStream << std::endl
-              << "};" << std::endl
-              << std::endl;
-    // close files
-    if (closeOutStream)
+    if (!hybridArchivePath.empty() && (commonHeaderFilePath.empty() || utilitiesFilePath.empty()))
     {
-        outStream.close();
+        std::cerr << "Option --hybrid has to be combined with -h and -u" << std::endl;
+        return false;
     }
-    inStream.close();
-    IF_BEVERBOSE(std::cout << " - succeeded." << std::endl)
-    return true;
-}
-
-static bool createCommonHeader(const std::vector<FileData> &fileList, const stdfs::path &commonHeaderPath, bool addUtilityFunctions, bool useCConstructs)
-{
-    // try opening the output file. truncate it when it exists
-    std::ofstream outStream;
-    outStream.open(commonHeaderPath.generic_string(), std::ofstream::out | std::ofstream::trunc);
-    if (!outStream.is_open() || !outStream.good())
+    if (compressData && !dataOnly && (commonHeaderFilePath.empty() || utilitiesFilePath.empty()))
     {
-        std::cerr << "Failed to open file \"" << commonHeaderPath << "\" for writing" << std::endl;
+        std::cerr << "Option --compress has to be combined with -h and -u or --data-only" << std::endl;
         return false;
     }
-    IF_BEVERBOSE(std::cout << std::endl
-                           << "Creating common header " << commonHeaderPath)
-    // add message
-    outStream << "// this file was auto-generated by res2h at " << currentDateAndTime() << std::endl
-              << std::endl;
-    // add #pragma to only include once
-    outStream << "#pragma once" << std::endl
-              << std::endl;
-    // add includes for C++
-    if (!useCConstructs)
+    if (!depfilePath.empty() && appendFile)
     {
-        outStream << "#include <string>" << std::endl;
-        if (addUtilityFunctions)
-        {
-            outStream << "#include <map>" << std::endl;
-        }
-        outStream << std::endl;
+        std::cerr << "Option --depfile can not be combined with -a" << std::endl;
+        return false;
     }
-    // add all files and check maximum size
-    uint64_t maxSize = 0;
-    for (const auto &fdIt : fileList)
+    if (!fileTransforms.empty() && (appendFile || outputMode == OutputMode::Asm))
     {
-        // add size and data variable
-        maxSize = maxSize < fdIt.size ? fdIt.size : maxSize;
-        if (fdIt.size <= UINT16_MAX)
-        {
-            outStream << "extern const uint16_t ";
-        }
-        else if (fdIt.size <= UINT32_MAX)
-        {
+        // assembler files include the input files using .incbin, so they would not see the transformed data
+        std::cerr << "Option --transform can not be combined with -a or -m asm" << std::endl;
+        return false;
+    }
+    if (watchForChanges && (appendFile || !manifestFilePath.empty()))
+    {
+        // the file list is kept in memory while watching, so a manifest is not needed
+        std::cerr << "Option --watch can not be combined with -a or --manifest" << std::endl;
+        return false;
+    }
+#if !defined(__linux__)
+    if (watchForChanges)
+    {
+        std::cerr << "Option --watch is only supported on Linux" << std::endl;
+        return false;
+    }
+#endif
+    if (dataOnly && noData)
+    {
+        std::cerr << "Options --data-only and --no-data can not be combined" << std::endl;
+        return false;
+    }
+    if ((dataOnly || noData) && (createBinary || appendFile || combineResults))
+    {
+        std::cerr << "Options --data-only and --no-data can not be combined with -b, -a or -1" << std::endl;
+        return false;
+    }
+    if (dataOnly && !utilitiesFilePath.empty())
+    {
+        std::cerr << "Option --data-only can not be combined with -u" << std::endl;
+        return false;
+    }
+    if (noData && (commonHeaderFilePath.empty() || !manifestFilePath.empty()))
+    {
+        std::cerr << "Option --no-data has to be combined with -h and can not be combined with --manifest" << std::endl;
+        return false;
+    }
+    if (combineResults && (outputMode == OutputMode::Elf || outputMode == OutputMode::Asm))
+    {
+        std::cerr << "Option -1 can not be combined with -m elf or -m asm" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/// @brief Apply the transforms for their extension to all files in fileList that were not transformed yet, using threadCount threads.
+/// The transformed content is kept in memory and the size of the files is set to its size. Streams are not transformed.
+static bool transformFiles(std::vector<FileData> &fileList, uint32_t threadCount)
+{
+    if (fileTransforms.empty())
+    {
+        return true;
+    }
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<std::size_t> indices;
+    uint64_t bytesRead = 0;
+    for (std::size_t index = 0; index < fileList.size(); ++index)
+    {
+        const auto &fileData = fileList[index];
+        if (!fileData.isStream && !fileData.transformedData && findTransforms(fileTransforms, fileData.inPath) != nullptr)
+        {
+            indices.push_back(index);
+            bytesRead += fileData.size;
+        }
+    }
+    // transform files in parallel. transforms running commands mostly wait for them
+    std::vector<std::string> errors(indices.size());
+    std::atomic<std::size_t> nextIndex(0);
+    auto worker = [&]() {
+        std::size_t index = 0;
+        while ((index = nextIndex++) < indices.size())
+        {
+            auto &fileData = fileList[indices[index]];
+            try
+            {
+                auto data = transformFile(fileData.inPath, *findTransforms(fileTransforms, fileData.inPath));
+                fileData.size = data.size();
+                fileData.transformedData = std::make_shared<const std::string>(std::move(data));
+            }
+            catch (const std::runtime_error &e)
+            {
+                errors[index] = e.what();
+            }
+        }
+    };
+    std::vector<std::thread> threads;
+    const auto usedThreads = std::min(static_cast<std::size_t>(threadCount), indices.size());
+    for (std::size_t i = 1; i < usedThreads; ++i)
+    {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+    // report in list order
+    bool succeeded = true;
+    for (std::size_t index = 0; index < indices.size(); ++index)
+    {
+        const auto &fileData = fileList[indices[index]];
+        if (!errors[index].empty())
+        {
+            std::cerr << "Failed to transform file \"" << fileData.inPath.string() << "\": " << errors[index] << std::endl;
+            succeeded = false;
+            continue;
+        }
+        IF_BEVERBOSE(std::cout << "Transformed input file " << fileData.inPath << " to " << fileData.size << " bytes" << std::endl)
+    }
+    statistics.phases.push_back({"transform", secondsSince(start), bytesRead});
+    return succeeded;
+}
+
+/// @brief Result and messages of converting one file on a worker thread.
+struct ConversionResult
+{
+    bool succeeded = false;
+    bool processed = false;
+    bool converted = false; // !<True if the file was read and converted and not skipped.
+    double seconds = 0; // !<Wall time spent converting the file.
+    std::ostringstream info;
+    std::ostringstream errors;
+};
+
+/// @brief Duplicates use the compressed data of the file with the same content. Copy its compressed size to them.
+static void copyCompressedSizesToDuplicates(std::vector<FileData> &fileList)
+{
+    std::map<stdfs::path, uint64_t> compressedSizes;
+    for (const auto &fileData : fileList)
+    {
+        if (!fileData.isDuplicate)
+        {
+            compressedSizes[fileData.outPath] = fileData.compressedSize;
+        }
+    }
+    for (auto &fileData : fileList)
+    {
+        fileData.compressedSize = compressedSizes[fileData.outPath];
+    }
+}
+
+/// @brief Convert all files in fileList to .c/.cpp files using threadCount threads.
+/// @param manifest Manifest of the last run. If useManifest is true, files that did not change since are skipped
+/// and the manifest is updated with the current state of all files when the function succeeds.
+static bool convertFiles(std::vector<FileData> &fileList, const stdfs::path &commonHeaderPath, uint32_t threadCount, Manifest &manifest, bool useManifest)
+{
+    // every file gets its own output stream and message buffers, so workers don't share state
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<ConversionResult> results(fileList.size());
+    std::vector<ManifestEntry> manifestEntries(useManifest ? fileList.size() : 0);
+    std::atomic<std::size_t> nextIndex(0);
+    std::atomic<bool> failed(false);
+    auto worker = [&]() {
+        // grab files in list order until all files are done or a conversion failed
+        std::size_t index = 0;
+        while (!failed && (index = nextIndex++) < fileList.size())
+        {
+            auto &result = results[index];
+            auto &fileData = fileList[index];
+            if (useManifest)
+            {
+                // check if the file needs to be converted at all
+                try
+                {
+                    manifestEntries[index] = createManifestEntry(fileData, manifest);
+                }
+                catch (const std::runtime_error &e)
+                {
+                    result.errors << "Failed to check file \"" << fileData.inPath.string() << "\" for changes: " << e.what() << std::endl;
+                    result.processed = true;
+                    failed = true;
+                    continue;
+                }
+                if (!fileData.isDuplicate && isUnchanged(fileData, manifestEntries[index], manifest))
+                {
+                    // the utilities table needs the size of the compressed data, which is only known after converting
+                    fileData.compressedSize = manifest.entries.at(fileData.inPath.generic_string()).compressedSize;
+                    manifestEntries[index].compressedSize = fileData.compressedSize;
+                    createVariableNames(fileData);
+                    IF_BEVERBOSE(result.info << "Skipping unchanged input file " << fileData.inPath << std::endl)
+                    result.succeeded = true;
+                    result.processed = true;
+                    continue;
+                }
+            }
+            if (fileData.isArchived)
+            {
+                // stored in the hybrid archive, which is written after converting
+                IF_BEVERBOSE(result.info << "Skipping input file " << fileData.inPath << " stored in archive" << std::endl)
+                result.succeeded = true;
+                result.processed = true;
+                continue;
+            }
+            if (noData && !fileData.isDuplicate)
+            {
+                // only the header and utilities are written. they need the variable names and the compressed size
+                createVariableNames(fileData);
+                result.succeeded = true;
+                if (compressData)
+                {
+                    std::ifstream fileStream;
+                    std::istringstream dataStream;
+                    std::istringstream compressedStream;
+                    result.succeeded = compressFile(openInputStream(fileData, fileStream, dataStream), fileData, compressedStream, result.errors);
+                }
+                result.processed = true;
+                if (!result.succeeded)
+                {
+                    failed = true;
+                }
+                continue;
+            }
+            if (fileData.isDuplicate)
+            {
+                // duplicates use the variables of the file with the same content
+                createVariableNames(fileData);
+                IF_BEVERBOSE(result.info << "Skipping duplicate input file " << fileData.inPath << std::endl)
+                result.succeeded = true;
+                result.processed = true;
+                continue;
+            }
+            std::ofstream outStream;
+            const auto start = std::chrono::steady_clock::now();
+            result.succeeded = convertFile(fileData, commonHeaderPath, convertOptions(), outStream, true, result.info, result.errors);
+            result.seconds = secondsSince(start);
+            result.converted = true;
+            result.processed = true;
+            if (useManifest)
+            {
+                manifestEntries[index].compressedSize = fileData.compressedSize;
+            }
+            if (!result.succeeded)
+            {
+                failed = true;
+            }
+        }
+    };
+    // run worker threads. the calling thread does its share of the work too
+    std::vector<std::thread> threads;
+    const auto usedThreads = std::min(static_cast<std::size_t>(threadCount), fileList.size());
+    for (std::size_t i = 1; i < usedThreads; ++i)
+    {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+    // print messages in list order up to the first file that failed. files are handed out in
+    // order, so all files before the first failure have been processed and the output is deterministic
+    uint64_t bytesConverted = 0;
+    for (std::size_t index = 0; index < results.size(); ++index)
+    {
+        const auto &result = results[index];
+        if (!result.processed)
+        {
+            break;
+        }
+        std::cout << result.info.str();
+        std::cerr << result.errors.str();
+        if (!result.succeeded)
+        {
+            return false;
+        }
+        if (result.converted)
+        {
+            statistics.files.push_back({fileList[index].inPath.string(), result.seconds, fileList[index].size});
+            bytesConverted += fileList[index].size;
+        }
+    }
+    statistics.phases.push_back({"convert", secondsSince(start), bytesConverted});
+    if (compressData)
+    {
+        copyCompressedSizesToDuplicates(fileList);
+    }
+    // store current state of all files. this drops files that are gone
+    if (useManifest)
+    {
+        manifest.entries.clear();
+        for (std::size_t index = 0; index < fileList.size(); ++index)
+        {
+            manifest.entries[fileList[index].inPath.generic_string()] = manifestEntries[index];
+        }
+    }
+    return true;
+}
+
+/// @brief Return the files sorted by internal name. This is the order of the res2hFiles table and of resource IDs.
+static std::vector<const FileData *> sortByInternalName(const std::vector<FileData> &fileList)
+{
+    // std::string compares like strcmp
+    std::vector<const FileData *> sortedFiles;
+    for (const auto &fd : fileList)
+    {
+        sortedFiles.push_back(&fd);
+    }
+    std::sort(sortedFiles.begin(), sortedFiles.end(), [](const FileData *a, const FileData *b) { return a->internalName < b->internalName; });
+    return sortedFiles;
+}
+
+/// @brief Return the hash of the internal name of a file, which is used as its ID. Same as Res2h::resourceId().
+static uint64_t resourceHash(const FileData &fileData)
+{
+    return calculateFNV1a64(reinterpret_cast<const uint8_t *>(fileData.internalName.data()), fileData.internalName.size());
+}
+
+/// @brief Return C identifiers for the IDs of the files in sortedFiles, built from their internal names, e.g. "subdir_a_txt" for ":/subdir/a.txt".
+/// Names that map to the same identifier get a number appended.
+static std::vector<std::string> resourceIdentifiers(const std::vector<const FileData *> &sortedFiles)
+{
+    std::vector<std::string> identifiers;
+    std::set<std::string> usedIdentifiers;
+    for (const auto fd : sortedFiles)
+    {
+        auto name = fd->internalName.compare(0, 2, ":/") == 0 ? fd->internalName.substr(2) : fd->internalName;
+        std::replace_if(name.begin(), name.end(), [](char c) { return !std::isalnum(static_cast<unsigned char>(c)); }, '_');
+        auto identifier = name;
+        for (uint32_t number = 2; !usedIdentifiers.insert(identifier).second; ++number)
+        {
+            identifier = name + "_" + std::to_string(number);
+        }
+        identifiers.push_back(identifier);
+    }
+    return identifiers;
+}
+
+/// @brief Check that the hashes of all internal names differ, so they can be used as IDs.
+static bool checkResourceHashes(const std::vector<FileData> &fileList)
+{
+    std::map<uint64_t, const FileData *> hashes;
+    for (const auto &fd : fileList)
+    {
+        const auto inserted = hashes.emplace(resourceHash(fd), &fd);
+        if (!inserted.second)
+        {
+            std::cerr << "Resources \"" << inserted.first->second->internalName << "\" and \"" << fd.internalName << "\" have the same ID. Rename one of them" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+/// @brief Write constexpr hash constants, which are the IDs of the files in sortedFiles, to outStream.
+static void writeHashConstants(std::ostream &outStream, const std::vector<const FileData *> &sortedFiles)
+{
+    const auto identifiers = resourceIdentifiers(sortedFiles);
+    for (std::size_t index = 0; index < sortedFiles.size(); ++index)
+    {
+        outStream << "constexpr uint64_t res2hHash_" << identifiers[index] << " = 0x" << std::hex << std::setw(16) << std::setfill('0') << resourceHash(*sortedFiles[index]) << std::dec << std::setfill(' ') << "ULL; // \"" << sortedFiles[index]->internalName << "\"" << std::endl;
+    }
+}
+
+/// @brief Write the resource IDs to the common header: An enum with the index of every file in res2hFiles and for C++ the hashes of their names.
+static void writeResourceIds(std::ostream &outStream, const std::vector<FileData> &fileList, bool useCConstructs)
+{
+    const auto sortedFiles = sortByInternalName(fileList);
+    const auto identifiers = resourceIdentifiers(sortedFiles);
+    outStream << "/* Index of every resource in res2hFiles. res2hGet() returns the entry for an ID without a lookup */" << std::endl;
+    outStream << "typedef enum Res2hId {" << std::endl;
+    for (std::size_t index = 0; index < sortedFiles.size(); ++index)
+    {
+        outStream << indent << "res2hId_" << identifiers[index] << " = " << index << (index + 1 < sortedFiles.size() ? "," : "") << std::endl;
+    }
+    outStream << "} Res2hId;" << std::endl
+              << std::endl;
+    outStream << (useCConstructs ? "static inline" : "inline") << " const Res2hEntry * res2hGet(Res2hId id) { return &res2hFiles[id]; }" << std::endl
+              << std::endl;
+    outStream << "/* Find resource by the 64bit FNV-1a hash of its relative file name using binary search. Returns a null pointer if not found */" << std::endl;
+    outStream << "const Res2hEntry * res2hFindHash(uint64_t hash);" << std::endl;
+    if (!useCConstructs)
+    {
+        // hashes can be computed at compile time, so looking up resources by name needs no string operations
+        outStream << std::endl;
+        outStream << "/* 64bit FNV-1a hash of a relative file name, e.g. \":/a.x\", usable in constant expressions. Same as Res2h::resourceId() */" << std::endl;
+        // C++11 constexpr functions may only consist of a return statement, so the loop is written as recursion
+        outStream << "constexpr uint64_t res2hHash(const char * relativeFileName, uint64_t hash = 0xcbf29ce484222325ULL)" << std::endl;
+        outStream << "{" << std::endl;
+        outStream << indent << "return *relativeFileName != '\\0' ? res2hHash(relativeFileName + 1, (hash ^ static_cast<uint8_t>(*relativeFileName)) * 0x100000001b3ULL) : hash;" << std::endl;
+        outStream << "}" << std::endl
+                  << std::endl;
+        writeHashConstants(outStream, sortedFiles);
+    }
+}
+
+static bool createCommonHeader(const std::vector<FileData> &fileList, const stdfs::path &commonHeaderPath, bool addUtilityFunctions, bool useCConstructs)
+{
+    // resource IDs must be unique
+    if (addUtilityFunctions && !checkResourceHashes(fileList))
+    {
+        return false;
+    }
+    // try opening a temporary output file. truncate it when it exists
+    std::ofstream outStream;
+    outStream.open(temporaryPath(commonHeaderPath).generic_string(), std::ofstream::out | std::ofstream::trunc);
+    if (!outStream.is_open() || !outStream.good())
+    {
+        std::cerr << "Failed to open file \"" << commonHeaderPath << "\" for writing" << std::endl;
+        return false;
+    }
+    IF_BEVERBOSE(std::cout << std::endl
+                           << "Creating common header " << commonHeaderPath)
+    // add message
+    outStream << "// this file was auto-generated by res2h" << std::endl
+              << std::endl;
+    // add #pragma to only include once
+    outStream << "#pragma once" << std::endl
+              << std::endl;
+    // add includes for C++
+    if (!useCConstructs)
+    {
+        outStream << "#include <cstdint>" << std::endl;
+        if (addUtilityFunctions)
+        {
+            outStream << "#include <string>" << std::endl;
+        }
+        outStream << std::endl;
+    }
+    else
+    {
+        outStream << "#include <stdint.h>" << std::endl
+                  << std::endl;
+        // make declarations usable from C++ too
+        outStream << "#ifdef __cplusplus" << std::endl;
+        outStream << "extern \"C\" {" << std::endl;
+        outStream << "#endif" << std::endl
+                  << std::endl;
+    }
+    // add segment struct for files that are split into chunks
+    if (shardSize > 0)
+    {
+        outStream << "typedef struct Res2hSegment {" << std::endl;
+        outStream << indent << "const uint8_t * data;" << std::endl;
+        outStream << indent << "const " << sizeTypeName(shardSize) << " size;" << std::endl;
+        outStream << "} Res2hSegment;" << std::endl
+                  << std::endl;
+    }
+    // add all files and check maximum size
+    uint64_t maxSize = 0;
+    for (const auto &fdIt : fileList)
+    {
+        // add size and data variable. duplicates use the variables of another file
+        maxSize = maxSize < fdIt.size ? fdIt.size : maxSize;
+        if (fdIt.isDuplicate || fdIt.isArchived)
+        {
+            continue;
+        }
+        if (fdIt.size <= UINT16_MAX)
+        {
+            outStream << "extern const uint16_t ";
+        }
+        else if (fdIt.size <= UINT32_MAX)
+        {
             outStream << "extern const uint32_t ";
         }
         else
@@ -393,301 +1135,908 @@ static bool createCommonHeader(const std::vector<FileData> &fileList, const stdf
             outStream << "extern const uint64_t ";
         }
         outStream << fdIt.sizeVariableName << ";" << std::endl;
-        outStream << "extern const uint8_t " << fdIt.dataVariableName << "[];" << std::endl
-                  << std::endl;
+        if (compressData)
+        {
+            maxSize = maxSize < fdIt.compressedSize ? fdIt.compressedSize : maxSize;
+            outStream << "extern const " << sizeTypeName(fdIt.compressedSize) << " " << compressedSizeVariableName(fdIt) << ";" << std::endl;
+        }
+        const auto chunks = nrOfChunks(fdIt, shardSize);
+        if (chunks == 1)
+        {
+            outStream << "extern const uint8_t " << fdIt.dataVariableName << "[];" << std::endl;
+        }
+        else
+        {
+            // split files have an array per chunk and a segment table instead of a data variable
+            for (uint64_t index = 0; index < chunks; ++index)
+            {
+                outStream << "extern const uint8_t " << chunkVariableName(fdIt, index) << "[];" << std::endl;
+            }
+            outStream << "extern const Res2hSegment " << segmentsVariableName(fdIt) << "[];" << std::endl;
+        }
+        outStream << std::endl;
     }
     // if we want utilities, add array
     if (addUtilityFunctions)
     {
-        // add resource struct
-        outStream << "struct Res2hEntry {" << std::endl;
-        if (useCConstructs)
+        // add resource struct. it only has members that can be initialized at compile time
+        outStream << "typedef struct Res2hEntry {" << std::endl;
+        outStream << indent << "const char * relativeFileName;" << std::endl;
+        //  add size member depending on the determined maximum file size
+        outStream << indent << "const " << sizeTypeName(maxSize) << " size;" << std::endl;
+        if (compressData)
         {
-            outStream << indent << "const char * relativeFileName;" << std::endl;
+            // data is LZ4-compressed. use res2hGetData() to get the uncompressed data
+            outStream << indent << "const " << sizeTypeName(maxSize) << " compressedSize;" << std::endl;
         }
-        else
+        outStream << indent << "const uint8_t * data;" << std::endl;
+        if (shardSize > 0)
+        {
+            // data is a null pointer for split files. walk the segments instead
+            outStream << indent << "const Res2hSegment * segments;" << std::endl;
+            outStream << indent << "const uint32_t nrOfSegments;" << std::endl;
+        }
+        outStream << "} Res2hEntry;" << std::endl
+                  << std::endl;
+        // add list holding files, sorted by name
+        outStream << "extern const uint32_t res2hNrOfFiles;" << std::endl;
+        outStream << "extern const Res2hEntry res2hFiles[];" << std::endl
+                  << std::endl;
+        // add lookup function
+        outStream << "/* Find resource by relative file name, e.g. \":/a.x\", using binary search. Returns a null pointer if not found */" << std::endl;
+        outStream << "const Res2hEntry * res2hFind(const char * relativeFileName);" << std::endl;
+        if (!useCConstructs)
+        {
+            outStream << "inline const Res2hEntry * res2hFind(const std::string & relativeFileName) { return res2hFind(relativeFileName.c_str()); }" << std::endl;
+        }
+        outStream << std::endl;
+        writeResourceIds(outStream, fileList, useCConstructs);
+        if (compressData)
+        {
+            outStream << std::endl;
+            outStream << "/* Decompress compressedSize bytes of LZ4 block data to decompressedSize bytes at destination. Returns 1 on success, 0 if the data is invalid */" << std::endl;
+            outStream << "int res2hDecompress(const uint8_t * data, uint64_t compressedSize, uint8_t * destination, uint64_t decompressedSize);" << std::endl;
+            outStream << "/* Get the uncompressed data of entry. It is decompressed on first use and cached until the program exits." << std::endl;
+            outStream << "   Stores the uncompressed size in size if it is not a null pointer. Returns a null pointer if decompression failed";
+            outStream << (useCConstructs ? ".\n   Not thread-safe. Synchronize calls if you use multiple threads */" : " */") << std::endl;
+            outStream << "const uint8_t * res2hGetData(const Res2hEntry * entry, uint64_t * size);" << std::endl;
+        }
+        if (!hybridArchivePath.empty())
+        {
+            outStream << std::endl;
+            outStream << "/* Get the data of entry. Embedded data is returned directly. The data of entries stored in the archive (data is a" << std::endl;
+            outStream << "   null pointer) is loaded using Res2h::loadResource() on first use and cached until the program exits. Load the" << std::endl;
+            outStream << "   archive using Res2h::instance().loadArchive() before. Stores the size in size if it is not a null pointer." << std::endl;
+            outStream << "   Returns a null pointer if loading failed */" << std::endl;
+            outStream << "const uint8_t * res2hGetData(const Res2hEntry * entry, uint64_t * size);" << std::endl;
+        }
+    }
+    if (useCConstructs)
+    {
+        outStream << std::endl
+                  << "#ifdef __cplusplus" << std::endl;
+        outStream << "}" << std::endl;
+        outStream << "#endif" << std::endl;
+    }
+    // close file. only replace the output file if something changed
+    if (!finishOutputFile(outStream, commonHeaderPath, beVerbose))
+    {
+        return false;
+    }
+    IF_BEVERBOSE(std::cout << " - succeeded." << std::endl)
+    return true;
+}
+
+/// @brief Write the data of all files to multiple source files next to utilitiesPath, each holding at most shardSize bytes of data.
+static bool createDataShards(const std::vector<FileData> &fileList, const stdfs::path &utilitiesPath, const stdfs::path &commonHeaderPath)
+{
+    // distribute chunks of all files to shards in list order, starting a new shard when the current one is full
+    std::vector<std::vector<std::pair<std::size_t, uint64_t>>> shards;
+    uint64_t shardBytes = 0;
+    for (std::size_t fileIndex = 0; fileIndex < fileList.size(); ++fileIndex)
+    {
+        if (fileList[fileIndex].isDuplicate)
+        {
+            continue;
+        }
+        for (uint64_t chunkIndex = 0; chunkIndex < nrOfChunks(fileList[fileIndex], shardSize); ++chunkIndex)
+        {
+            const auto bytes = chunkSize(fileList[fileIndex], chunkIndex, shardSize);
+            if (shards.empty() || (shardBytes > 0 && shardBytes + bytes > shardSize))
+            {
+                shards.emplace_back();
+                shardBytes = 0;
+            }
+            shards.back().emplace_back(fileIndex, chunkIndex);
+            shardBytes += bytes;
+        }
+    }
+    // write shards to files named like the utilities file plus a shard number
+    for (std::size_t shardIndex = 0; shardIndex < shards.size(); ++shardIndex)
+    {
+        auto shardPath = utilitiesPath;
+        shardPath.replace_filename(utilitiesPath.stem().string() + "_" + std::to_string(shardIndex) + utilitiesPath.extension().string());
+        std::ofstream outStream(temporaryPath(shardPath).string(), std::ofstream::out | std::ofstream::trunc);
+        if (!outStream.is_open() || !outStream.good())
+        {
+            std::cerr << "Failed to open file \"" << shardPath.string() << "\" for writing" << std::endl;
+            return false;
+        }
+        IF_BEVERBOSE(std::cout << std::endl
+                               << "Creating data shard " << shardPath)
+        outStream << "// this file was auto-generated by res2h" << std::endl
+                  << std::endl;
+        outStream << "#include \"" << naiveRelative(commonHeaderPath, shardPath).generic_string() << "\"" << std::endl
+                  << std::endl;
+        for (const auto &chunk : shards[shardIndex])
+        {
+            const auto &fileData = fileList[chunk.first];
+            std::ifstream fileStream;
+            std::istringstream dataStream;
+            auto &inStream = openInputStream(fileData, fileStream, dataStream);
+            if (!inStream.good())
+            {
+                std::cerr << "Failed to open file \"" << fileData.inPath.string() << "\" for reading" << std::endl;
+                return false;
+            }
+            writeChunk(inStream, outStream, fileData, chunk.second, convertOptions());
+        }
+        if (!finishOutputFile(outStream, shardPath, beVerbose))
+        {
+            return false;
+        }
+        IF_BEVERBOSE(std::cout << " - succeeded." << std::endl)
+    }
+    return true;
+}
+
+/// @brief Write the table of name hashes sorted by hash and res2hFindHash(), which finds resources by hash using binary search.
+static void writeHashLookup(std::ostream &outStream, const std::vector<const FileData *> &sortedFiles)
+{
+    std::vector<std::pair<uint64_t, std::size_t>> hashes;
+    for (std::size_t index = 0; index < sortedFiles.size(); ++index)
+    {
+        hashes.emplace_back(resourceHash(*sortedFiles[index]), index);
+    }
+    std::sort(hashes.begin(), hashes.end());
+    outStream << "typedef struct Res2hHashEntry {" << std::endl;
+    outStream << indent << "uint64_t hash;" << std::endl;
+    outStream << indent << "uint32_t index;" << std::endl;
+    outStream << "} Res2hHashEntry;" << std::endl
+              << std::endl;
+    writeSectionAttribute(outStream, ".rodata.res2h.res2hHashes", convertOptions());
+    outStream << "static const Res2hHashEntry res2hHashes[" << hashes.size() << "] = {" << std::endl;
+    for (auto hIt = hashes.cbegin(); hIt != hashes.cend(); ++hIt)
+    {
+        outStream << indent << "{0x" << std::hex << std::setw(16) << std::setfill('0') << hIt->first << std::dec << std::setfill(' ') << "ULL, " << hIt->second << "}" << (hIt + 1 != hashes.cend() ? "," : "") << std::endl;
+    }
+    outStream << "};" << std::endl
+              << std::endl;
+    writeSectionAttribute(outStream, ".text.res2h.res2hFindHash", convertOptions());
+    outStream << "const Res2hEntry * res2hFindHash(uint64_t hash)" << std::endl;
+    outStream << "{" << std::endl;
+    outStream << indent << "uint32_t first = 0;" << std::endl;
+    outStream << indent << "uint32_t last = res2hNrOfFiles;" << std::endl;
+    outStream << indent << "while (first < last)" << std::endl;
+    outStream << indent << "{" << std::endl;
+    outStream << indent << indent << "const uint32_t middle = first + (last - first) / 2;" << std::endl;
+    outStream << indent << indent << "if (res2hHashes[middle].hash == hash)" << std::endl;
+    outStream << indent << indent << "{" << std::endl;
+    outStream << indent << indent << indent << "return &res2hFiles[res2hHashes[middle].index];" << std::endl;
+    outStream << indent << indent << "}" << std::endl;
+    outStream << indent << indent << "if (res2hHashes[middle].hash < hash)" << std::endl;
+    outStream << indent << indent << "{" << std::endl;
+    outStream << indent << indent << indent << "first = middle + 1;" << std::endl;
+    outStream << indent << indent << "}" << std::endl;
+    outStream << indent << indent << "else" << std::endl;
+    outStream << indent << indent << "{" << std::endl;
+    outStream << indent << indent << indent << "last = middle;" << std::endl;
+    outStream << indent << indent << "}" << std::endl;
+    outStream << indent << "}" << std::endl;
+    outStream << indent << "return 0;" << std::endl;
+    outStream << "}" << std::endl;
+}
+
+/// @brief Write res2hGetData() for --hybrid, which returns embedded data or loads and caches data from the archive using Res2h.
+static void writeArchiveLoadFunction(std::ostream &outStream, std::size_t nrOfFiles)
+{
+    // the cache holds the data of every table entry loaded from the archive
+    outStream << "static std::vector<uint8_t> res2hCache[" << nrOfFiles << "];" << std::endl;
+    outStream << "static std::mutex res2hCacheMutex;" << std::endl;
+    outStream << std::endl;
+    outStream << "const uint8_t * res2hGetData(const Res2hEntry * entry, uint64_t * size)" << std::endl;
+    outStream << "{" << std::endl;
+    outStream << indent << "const uint8_t * data = entry->data;" << std::endl;
+    outStream << indent << "if (data == 0)" << std::endl;
+    outStream << indent << "{" << std::endl;
+    outStream << indent << indent << "/* archived files are bigger than the threshold, so they are never empty */" << std::endl;
+    outStream << indent << indent << "std::lock_guard<std::mutex> lock(res2hCacheMutex);" << std::endl;
+    outStream << indent << indent << "std::vector<uint8_t> & cached = res2hCache[entry - res2hFiles];" << std::endl;
+    outStream << indent << indent << "if (cached.empty())" << std::endl;
+    outStream << indent << indent << "{" << std::endl;
+    outStream << indent << indent << indent << "try" << std::endl;
+    outStream << indent << indent << indent << "{" << std::endl;
+    outStream << indent << indent << indent << indent << "cached = Res2h::instance().loadResource(entry->relativeFileName).data;" << std::endl;
+    outStream << indent << indent << indent << "}" << std::endl;
+    outStream << indent << indent << indent << "catch (const Res2hException &)" << std::endl;
+    outStream << indent << indent << indent << "{" << std::endl;
+    outStream << indent << indent << indent << indent << "return 0;" << std::endl;
+    outStream << indent << indent << indent << "}" << std::endl;
+    outStream << indent << indent << "}" << std::endl;
+    outStream << indent << indent << "data = cached.data();" << std::endl;
+    outStream << indent << "}" << std::endl;
+    outStream << indent << "if (size != 0)" << std::endl;
+    outStream << indent << "{" << std::endl;
+    outStream << indent << indent << "*size = entry->size;" << std::endl;
+    outStream << indent << "}" << std::endl;
+    outStream << indent << "return data;" << std::endl;
+    outStream << "}" << std::endl;
+}
+
+/// @brief Write the LZ4 decompressor and res2hGetData() that decompresses and caches the data of table entries.
+static void writeDecompressionFunctions(std::ostream &outStream, std::size_t nrOfFiles)
+{
+    outStream << "/* read a length that does not fit into the 4 bits of the token */" << std::endl;
+    outStream << "static int res2hReadLength(const uint8_t * data, uint64_t compressedSize, uint64_t * position, uint64_t * length)" << std::endl;
+    outStream << "{" << std::endl;
+    outStream << indent << "uint8_t extra = 255;" << std::endl;
+    outStream << indent << "while (extra == 255)" << std::endl;
+    outStream << indent << "{" << std::endl;
+    outStream << indent << indent << "if (*position >= compressedSize)" << std::endl;
+    outStream << indent << indent << "{" << std::endl;
+    outStream << indent << indent << indent << "return 0;" << std::endl;
+    outStream << indent << indent << "}" << std::endl;
+    outStream << indent << indent << "extra = data[(*position)++];" << std::endl;
+    outStream << indent << indent << "*length += extra;" << std::endl;
+    outStream << indent << "}" << std::endl;
+    outStream << indent << "return 1;" << std::endl;
+    outStream << "}" << std::endl;
+    outStream << std::endl;
+    outStream << "int res2hDecompress(const uint8_t * data, uint64_t compressedSize, uint8_t * destination, uint64_t decompressedSize)" << std::endl;
+    outStream << "{" << std::endl;
+    outStream << indent << "uint64_t in = 0;" << std::endl;
+    outStream << indent << "uint64_t out = 0;" << std::endl;
+    outStream << indent << "while (in < compressedSize)" << std::endl;
+    outStream << indent << "{" << std::endl;
+    outStream << indent << indent << "/* token holds the number of literals in the high and the match length in the low nibble */" << std::endl;
+    outStream << indent << indent << "const uint8_t token = data[in++];" << std::endl;
+    outStream << indent << indent << "uint64_t length = token >> 4;" << std::endl;
+    outStream << indent << indent << "uint64_t offset = 0;" << std::endl;
+    outStream << indent << indent << "if (length == 15 && !res2hReadLength(data, compressedSize, &in, &length))" << std::endl;
+    outStream << indent << indent << "{" << std::endl;
+    outStream << indent << indent << indent << "return 0;" << std::endl;
+    outStream << indent << indent << "}" << std::endl;
+    outStream << indent << indent << "if (length > compressedSize - in || length > decompressedSize - out)" << std::endl;
+    outStream << indent << indent << "{" << std::endl;
+    outStream << indent << indent << indent << "return 0;" << std::endl;
+    outStream << indent << indent << "}" << std::endl;
+    outStream << indent << indent << "memcpy(destination + out, data + in, length);" << std::endl;
+    outStream << indent << indent << "in += length;" << std::endl;
+    outStream << indent << indent << "out += length;" << std::endl;
+    outStream << indent << indent << "/* the last sequence only has literals */" << std::endl;
+    outStream << indent << indent << "if (in == compressedSize)" << std::endl;
+    outStream << indent << indent << "{" << std::endl;
+    outStream << indent << indent << indent << "break;" << std::endl;
+    outStream << indent << indent << "}" << std::endl;
+    outStream << indent << indent << "if (compressedSize - in < 2)" << std::endl;
+    outStream << indent << indent << "{" << std::endl;
+    outStream << indent << indent << indent << "return 0;" << std::endl;
+    outStream << indent << indent << "}" << std::endl;
+    outStream << indent << indent << "offset = data[in] + 256u * data[in + 1];" << std::endl;
+    outStream << indent << indent << "in += 2;" << std::endl;
+    outStream << indent << indent << "if (offset == 0 || offset > out)" << std::endl;
+    outStream << indent << indent << "{" << std::endl;
+    outStream << indent << indent << indent << "return 0;" << std::endl;
+    outStream << indent << indent << "}" << std::endl;
+    outStream << indent << indent << "length = (token & 15u) + 4;" << std::endl;
+    outStream << indent << indent << "if ((token & 15u) == 15 && !res2hReadLength(data, compressedSize, &in, &length))" << std::endl;
+    outStream << indent << indent << "{" << std::endl;
+    outStream << indent << indent << indent << "return 0;" << std::endl;
+    outStream << indent << indent << "}" << std::endl;
+    outStream << indent << indent << "if (length > decompressedSize - out)" << std::endl;
+    outStream << indent << indent << "{" << std::endl;
+    outStream << indent << indent << indent << "return 0;" << std::endl;
+    outStream << indent << indent << "}" << std::endl;
+    outStream << indent << indent << "/* copy byte by byte, because source and destination may overlap */" << std::endl;
+    outStream << indent << indent << "for (; length > 0; --length, ++out)" << std::endl;
+    outStream << indent << indent << "{" << std::endl;
+    outStream << indent << indent << indent << "destination[out] = destination[out - offset];" << std::endl;
+    outStream << indent << indent << "}" << std::endl;
+    outStream << indent << "}" << std::endl;
+    outStream << indent << "return out == decompressedSize;" << std::endl;
+    outStream << "}" << std::endl;
+    outStream << std::endl;
+    // the cache holds the uncompressed data of every table entry. in C++ it is guarded by a mutex
+    outStream << "static const uint8_t * res2hCache[" << nrOfFiles << "];" << std::endl;
+    if (!useC)
+    {
+        outStream << "static std::mutex res2hCacheMutex;" << std::endl;
+    }
+    outStream << std::endl;
+    outStream << "const uint8_t * res2hGetData(const Res2hEntry * entry, uint64_t * size)" << std::endl;
+    outStream << "{" << std::endl;
+    outStream << indent << "const uint8_t ** cached = &res2hCache[entry - res2hFiles];" << std::endl;
+    if (!useC)
+    {
+        outStream << indent << "std::lock_guard<std::mutex> lock(res2hCacheMutex);" << std::endl;
+    }
+    outStream << indent << "if (*cached == 0)" << std::endl;
+    outStream << indent << "{" << std::endl;
+    outStream << indent << indent << "/* allocate at least one byte, so empty files get a valid pointer too */" << std::endl;
+    outStream << indent << indent << "uint8_t * data = " << (useC ? "(uint8_t *)" : "static_cast<uint8_t *>(") << "malloc(entry->size > 0 ? entry->size : 1)" << (useC ? "" : ")") << ";" << std::endl;
+    outStream << indent << indent << "if (data == 0 || !res2hDecompress(entry->data, entry->compressedSize, data, entry->size))" << std::endl;
+    outStream << indent << indent << "{" << std::endl;
+    outStream << indent << indent << indent << "free(data);" << std::endl;
+    outStream << indent << indent << indent << "return 0;" << std::endl;
+    outStream << indent << indent << "}" << std::endl;
+    outStream << indent << indent << "*cached = data;" << std::endl;
+    outStream << indent << "}" << std::endl;
+    outStream << indent << "if (size != 0)" << std::endl;
+    outStream << indent << "{" << std::endl;
+    outStream << indent << indent << "*size = entry->size;" << std::endl;
+    outStream << indent << "}" << std::endl;
+    outStream << indent << "return *cached;" << std::endl;
+    outStream << "}" << std::endl;
+}
+
+static bool createUtilities(std::vector<FileData> &fileList, const stdfs::path &utilitiesPath, const stdfs::path &commonHeaderPath, bool addFileData)
+{
+    // try opening a temporary output file. truncate it when it exists
+    std::ofstream outStream;
+    outStream.open(temporaryPath(utilitiesPath).generic_string(), std::ofstream::out | std::ofstream::trunc);
+    if (!outStream.is_open() || !outStream.good())
+    {
+        std::cerr << "Failed to open file \"" << utilitiesPath << "\" for writing" << std::endl;
+        return false;
+    }
+    IF_BEVERBOSE(std::cout << std::endl
+                           << "Creating utilities file " << utilitiesPath)
+    // add message
+    outStream << "// this file was auto-generated by res2h" << std::endl
+              << std::endl;
+    // create path to include file RELATIVE to this file
+    stdfs::path relativePath = naiveRelative(commonHeaderPath, utilitiesPath);
+    // include header file and strcmp
+    outStream << "#include \"" << relativePath.string() << "\"" << std::endl
+              << std::endl;
+    outStream << "#include <string.h>" << std::endl;
+    if (compressData)
+    {
+        // decompressed data is allocated using malloc
+        outStream << "#include <stdlib.h>" << std::endl;
+        if (!useC)
+        {
+            outStream << "#include <mutex>" << std::endl;
+        }
+    }
+    if (!hybridArchivePath.empty())
+    {
+        // archived data is loaded using the archive interface of res2h
+        outStream << "#include <mutex>" << std::endl;
+        outStream << "#include <vector>" << std::endl;
+        outStream << std::endl;
+        outStream << "#include \"res2hinterface.h\"" << std::endl;
+    }
+    outStream << std::endl;
+    // if the data should go to this file too, add it. if it is sharded, it goes to separate files
+    if (addFileData && shardSize > 0)
+    {
+        if (!createDataShards(fileList, utilitiesPath, commonHeaderPath))
+        {
+            std::cerr << "Failed to convert all files. Aborting" << std::endl;
+            outStream.close();
+            return false;
+        }
+    }
+    else if (addFileData)
+    {
+        for (auto &fd : fileList)
+        {
+            if (!fd.isDuplicate && !fd.isArchived && !convertFile(fd, commonHeaderFilePath, convertOptions(), outStream, false))
+            {
+                std::cerr << "Failed to convert all files. Aborting" << std::endl;
+                outStream.close();
+                return false;
+            }
+        }
+    }
+    // sort entries by name, so they can be found using binary search
+    const auto sortedFiles = sortByInternalName(fileList);
+    // add files. only use literals and addresses, so the table is initialized at compile time
+    outStream << "const uint32_t res2hNrOfFiles = " << fileList.size() << ";" << std::endl;
+    // the table references all data arrays. with its own section the linker can drop it and all data when it is not used.
+    // it holds addresses, so it must go to a relocatable read-only section for position-independent code
+    writeSectionAttribute(outStream, ".data.rel.ro.res2h.res2hFiles", convertOptions());
+    outStream << "const Res2hEntry res2hFiles[" << fileList.size() << "] = {" << std::endl;
+    for (auto fdIt = sortedFiles.cbegin(); fdIt != sortedFiles.cend(); ++fdIt)
+    {
+        const auto &fd = **fdIt;
+        outStream << indent << "{\"" << fd.internalName << "\", " << std::dec << fd.size << ", ";
+        if (compressData)
         {
-            outStream << indent << "const std::string relativeFileName;" << std::endl;
+            outStream << fd.compressedSize << ", ";
         }
-        //  add size member depending on the determined maximum file size
-        if (maxSize <= UINT16_MAX)
+        if (fd.isArchived)
         {
-            outStream << indent << "const uint16_t size;" << std::endl;
+            outStream << "0";
         }
-        else if (maxSize <= UINT32_MAX)
+        else if (shardSize == 0)
         {
-            outStream << indent << "const uint32_t size;" << std::endl;
+            outStream << fd.dataVariableName;
         }
-        else
+        else if (nrOfChunks(fd, shardSize) == 1)
         {
-            outStream << indent << "const uint64_t size;" << std::endl;
+            outStream << fd.dataVariableName << ", 0, 0";
         }
-        outStream << indent << "const uint8_t * data;" << std::endl;
-        outStream << "};" << std::endl
-                  << std::endl;
-        // add list holding files
-        outStream << "extern const uint32_t res2hNrOfFiles;" << std::endl;
-        outStream << "extern const Res2hEntry res2hFiles[];" << std::endl
-                  << std::endl;
-        if (!useCConstructs)
+        else
         {
-            // add additional std::map if C++
-            outStream << "typedef const std::map<const std::string, const Res2hEntry> res2hMapType;" << std::endl;
-            outStream << "extern res2hMapType res2hMap;" << std::endl;
+            outStream << "0, " << segmentsVariableName(fd) << ", " << nrOfChunks(fd, shardSize);
         }
+        // add comma if this is not the last entry
+        outStream << "}" << (fdIt + 1 != sortedFiles.cend() ? "," : "") << std::endl;
+    }
+    outStream << "};" << std::endl
+              << std::endl;
+    // add lookup function
+    writeSectionAttribute(outStream, ".text.res2h.res2hFind", convertOptions());
+    outStream << "const Res2hEntry * res2hFind(const char * relativeFileName)" << std::endl;
+    outStream << "{" << std::endl;
+    outStream << indent << "uint32_t first = 0;" << std::endl;
+    outStream << indent << "uint32_t last = res2hNrOfFiles;" << std::endl;
+    outStream << indent << "while (first < last)" << std::endl;
+    outStream << indent << "{" << std::endl;
+    outStream << indent << indent << "const uint32_t middle = first + (last - first) / 2;" << std::endl;
+    outStream << indent << indent << "const int result = strcmp(res2hFiles[middle].relativeFileName, relativeFileName);" << std::endl;
+    outStream << indent << indent << "if (result == 0)" << std::endl;
+    outStream << indent << indent << "{" << std::endl;
+    outStream << indent << indent << indent << "return &res2hFiles[middle];" << std::endl;
+    outStream << indent << indent << "}" << std::endl;
+    outStream << indent << indent << "if (result < 0)" << std::endl;
+    outStream << indent << indent << "{" << std::endl;
+    outStream << indent << indent << indent << "first = middle + 1;" << std::endl;
+    outStream << indent << indent << "}" << std::endl;
+    outStream << indent << indent << "else" << std::endl;
+    outStream << indent << indent << "{" << std::endl;
+    outStream << indent << indent << indent << "last = middle;" << std::endl;
+    outStream << indent << indent << "}" << std::endl;
+    outStream << indent << "}" << std::endl;
+    outStream << indent << "return 0;" << std::endl;
+    outStream << "}" << std::endl;
+    outStream << std::endl;
+    writeHashLookup(outStream, sortedFiles);
+    if (compressData)
+    {
+        outStream << std::endl;
+        writeDecompressionFunctions(outStream, fileList.size());
+    }
+    if (!hybridArchivePath.empty())
+    {
+        outStream << std::endl;
+        writeArchiveLoadFunction(outStream, fileList.size());
+    }
+    // close file. only replace the output file if something changed
+    if (!finishOutputFile(outStream, utilitiesPath, beVerbose))
+    {
+        return false;
     }
-    // close file
-    outStream.close();
     IF_BEVERBOSE(std::cout << " - succeeded." << std::endl)
     return true;
 }
 
-static bool createUtilities(std::vector<FileData> &fileList, const stdfs::path &utilitiesPath, const stdfs::path &commonHeaderPath, bool useCConstructs, bool addFileData)
+/// @brief Write a C++ header with the IDs of all resources in the archive archivePath for Res2h::loadResource(ResourceId).
+static bool createIdHeader(const std::vector<FileData> &fileList, const stdfs::path &archivePath, const stdfs::path &headerPath)
 {
-    // try opening the output file. truncate it when it exists
+    if (!checkResourceHashes(fileList))
+    {
+        return false;
+    }
     std::ofstream outStream;
-    outStream.open(utilitiesPath.generic_string(), std::ofstream::out | std::ofstream::trunc);
+    outStream.open(temporaryPath(headerPath).generic_string(), std::ofstream::out | std::ofstream::trunc);
     if (!outStream.is_open() || !outStream.good())
     {
-        std::cerr << "Failed to open file \"" << utilitiesPath << "\" for writing" << std::endl;
+        std::cerr << "Failed to open file \"" << headerPath << "\" for writing" << std::endl;
         return false;
     }
-    IF_BEVERBOSE(std::cout << std::endl
-                           << "Creating utilities file " << utilitiesPath)
-    // add message
-    outStream << "// this file was auto-generated by res2h at " << currentDateAndTime() << std::endl
+    IF_BEVERBOSE(std::cout << "Creating resource ID header " << headerPath << std::endl)
+    outStream << "// this file was auto-generated by res2h" << std::endl
               << std::endl;
-    // create path to include file RELATIVE to this file
-    stdfs::path relativePath = naiveRelative(commonHeaderPath, utilitiesPath);
-    // include header file
-    outStream << "#include \"" << relativePath.string() << "\"" << std::endl
+    outStream << "#pragma once" << std::endl
               << std::endl;
-    // if the data should go to this file too, add it
-    if (addFileData)
+    outStream << "#include <cstdint>" << std::endl
+              << std::endl;
+    outStream << "// IDs of the resources in archive \"" << archivePath.filename().string() << "\" for Res2h::loadResource()" << std::endl;
+    writeHashConstants(outStream, sortByInternalName(fileList));
+    return finishOutputFile(outStream, headerPath, beVerbose);
+}
+
+/// @brief Escape a path for use in a Make / Ninja depfile.
+static std::string escapeDepfilePath(const stdfs::path &path)
+{
+    std::string result;
+    for (const char c : path.generic_string())
     {
-        for (auto &fd : fileList)
+        if (c == ' ' || c == '#')
         {
-            if (!convertFile(fd, commonHeaderFilePath, outStream, false))
-            {
-                std::cerr << "Failed to convert all files. Aborting" << std::endl;
-                outStream.close();
-                return false;
-            }
+            result += '\\';
         }
-    }
-    // begin data arrays. switch depending whether C or C++
-    outStream << "const uint32_t res2hNrOfFiles = " << fileList.size() << ";" << std::endl;
-    // add files
-    outStream << "const Res2hEntry res2hFiles[res2hNrOfFiles] = {" << std::endl;
-    outStream << indent; // first indent
-    for (auto fdIt = fileList.cbegin(); fdIt != fileList.cend();)
-    {
-        outStream << "{\"" << fdIt->internalName << "\", " << fdIt->sizeVariableName << ", " << fdIt->dataVariableName << "}";
-        // was this the last entry?
-        ++fdIt;
-        if (fdIt != fileList.cend())
+        else if (c == '$')
         {
-            // no. add comma.
-            outStream << ",";
-            // add break after every entry and add indent again
-            outStream << std::endl
-                      << indent;
+            result += '$';
         }
+        result += c;
     }
-    outStream << std::endl
-              << "};" << std::endl;
-    if (!useCConstructs)
+    return result;
+}
+
+/// @brief Write a depfile listing all input files and directories, so the build system runs res2h again if files are changed, added or removed.
+/// The target is the common header if it is written, else the output file / directory.
+static bool createDepfile(const stdfs::path &depfilePath, const std::vector<FileData> &fileList, const std::vector<stdfs::path> &directories)
+{
+    std::ofstream outStream;
+    outStream.open(temporaryPath(depfilePath).string(), std::ofstream::out | std::ofstream::trunc);
+    if (!outStream.is_open() || !outStream.good())
     {
-        // add files to map
-        outStream << std::endl
-                  << "res2hMapType::value_type mapTemp[] = {" << std::endl;
-        outStream << indent;
-        for (auto fdIt = fileList.cbegin(); fdIt != fileList.cend();)
+        std::cerr << "Failed to open file \"" << depfilePath.string() << "\" for writing" << std::endl;
+        return false;
+    }
+    IF_BEVERBOSE(std::cout << std::endl
+                           << "Creating depfile " << depfilePath)
+    const auto &target = (!commonHeaderFilePath.empty() && !dataOnly) ? commonHeaderFilePath : outFilePath;
+    outStream << escapeDepfilePath(target) << ":";
+    // directories change when files are added or removed
+    for (const auto &directory : directories)
+    {
+        outStream << " \\" << std::endl
+                  << indent << escapeDepfilePath(directory);
+    }
+    for (const auto &fileData : fileList)
+    {
+        // stdin and pipes are no files the build system could check
+        if (fileData.isStream)
         {
-            outStream << "std::make_pair(\"" << fdIt->internalName << "\", res2hFiles[" << (fdIt - fileList.cbegin()) << "])";
-            // was this the last entry?
-            ++fdIt;
-            if (fdIt != fileList.cend())
-            {
-                // no. add comma.
-                outStream << ",";
-                // add break after every entry and add indent again
-                outStream << std::endl
-                          << indent;
-            }
+            continue;
         }
-        outStream << std::endl
-                  << "};" << std::endl
-                  << std::endl;
-        // create map
-        outStream << "res2hMapType res2hMap(mapTemp, mapTemp + sizeof mapTemp / sizeof mapTemp[0]);" << std::endl;
+        outStream << " \\" << std::endl
+                  << indent << escapeDepfilePath(fileData.inPath);
+    }
+    outStream << std::endl;
+    if (!finishOutputFile(outStream, depfilePath, beVerbose))
+    {
+        return false;
     }
-    // close file
-    outStream.close();
     IF_BEVERBOSE(std::cout << " - succeeded." << std::endl)
     return true;
 }
 
-static bool createBlob(const std::vector<FileData> &fileList, const stdfs::path &filePath)
+#if defined(__linux__)
+/// @brief Return the paths of all files the output of the files in fileList is written to.
+/// Duplicates and archived files have no output of their own.
+static std::set<stdfs::path> sourceOutputPaths(const std::vector<FileData> &fileList)
 {
-    // try opening the output file. truncate it when it exists
-    std::fstream outStream;
-    outStream.open(filePath.string(), std::ofstream::out | std::ofstream::binary | std::ofstream::trunc);
-    if (!outStream.is_open() || !outStream.good())
+    std::set<stdfs::path> outputPaths;
+    for (const auto &fileData : fileList)
+    {
+        if (fileData.isDuplicate || fileData.isArchived)
+        {
+            continue;
+        }
+        for (uint64_t chunkIndex = 0; chunkIndex < nrOfChunks(fileData, shardSize); ++chunkIndex)
+        {
+            outputPaths.insert(chunkOutputPath(fileData, chunkIndex));
+        }
+    }
+    return outputPaths;
+}
+
+/// @brief Scan the input directory again and update all outputs after files were changed, added or removed.
+/// Files are only converted again if they are new, in changedPaths or their size, output path or duplicate state changed.
+/// Archives are only written again if a file stored in them changed. Header, utilities and depfile are written
+/// again, but only replaced if their content changed. Outputs of files that are gone are removed.
+/// @param fileList Files of the last run. Receives the current files.
+/// @param directories Directories of the last run. Receives the current directories.
+/// @param changedPaths Files that were written since the last run.
+/// @param convertAll Convert all files, e.g. because events were lost.
+/// @param nrOfConverted Receives the number of files converted or written to an archive.
+static bool updateOutputs(std::vector<FileData> &fileList, std::vector<stdfs::path> &directories, const std::set<stdfs::path> &changedPaths, bool convertAll, std::size_t &nrOfConverted)
+{
+    nrOfConverted = 0;
+    std::vector<stdfs::path> newDirectories;
+    auto newList = getFileData(inFilePath, inFilePath, useRecursion, beVerbose, nrOfThreads, &newDirectories);
+    directories = newDirectories;
+    if (newList.empty())
+    {
+        // keep the outputs of the last run. they are updated when files are added again
+        std::cerr << "Found no files to convert" << std::endl;
+        return true;
+    }
+    // only transform files again if they changed
+    std::map<stdfs::path, const FileData *> oldFiles;
+    for (const auto &fileData : fileList)
+    {
+        oldFiles[fileData.inPath] = &fileData;
+    }
+    for (auto &fileData : newList)
+    {
+        const auto oldIt = oldFiles.find(fileData.inPath);
+        if (!convertAll && oldIt != oldFiles.cend() && oldIt->second->transformedData && changedPaths.count(fileData.inPath) == 0)
+        {
+            fileData.transformedData = oldIt->second->transformedData;
+            fileData.size = oldIt->second->size;
+        }
+    }
+    if (!transformFiles(newList, nrOfThreads))
     {
-        std::cerr << "Failed to open file \"" << filePath.string() << "\" for writing" << std::endl;
         return false;
     }
-    const auto nrOfEntries = static_cast<uint32_t>(fileList.size());
-    // check if a 64bit archive is needed, or 32bits suffice
-    uint64_t directorySize = 0;
-    uint64_t maxDataSize = 0;
-    uint64_t dataSize = 0;
-    for (const auto &file : fileList)
+    generateOutputPaths(newList, inFilePath, outFilePath, outputFileExtension(), beVerbose);
+    if (deduplicate)
     {
-        dataSize += file.size;
-        maxDataSize = maxDataSize < file.size ? file.size : maxDataSize;
-        directorySize += file.internalName.size();
+        markDuplicates(newList, beVerbose);
     }
-    // now take worst case header and fixed directory size into account and check if we need 32 or 64 bit
-    const bool mustUse64Bit = maxDataSize > UINT32_MAX || (RES2H_HEADER_SIZE_64 + directorySize + nrOfEntries * RES2H_DIRECTORY_SIZE_64 + dataSize + sizeof(uint64_t)) > UINT32_MAX;
-    IF_BEVERBOSE(std::cout << std::endl
-                           << "Creating binary " << (mustUse64Bit ? "64" : "32") << "bit archive " << filePath << std::endl)
-    // now that we know how many bits, add the correct amount of data for the fixed directory entries to the variable
-    directorySize += nrOfEntries * (mustUse64Bit ? RES2H_DIRECTORY_SIZE_64 : RES2H_DIRECTORY_SIZE_32);
-    // add magic number to file
-    outStream.write(reinterpret_cast<const char *>(&RES2H_MAGIC_BYTES), sizeof(RES2H_MAGIC_BYTES) - 1);
-    // add version and format flag to file
-    const uint32_t fileVersion = RES2H_ARCHIVE_VERSION;
-    const uint32_t fileFlags = mustUse64Bit ? 64 : 32;
-    outStream.write(reinterpret_cast<const char *>(&fileVersion), sizeof(uint32_t));
-    outStream.write(reinterpret_cast<const char *>(&fileFlags), sizeof(uint32_t));
-    // add dummy archive size to file
-    uint64_t archiveSize = 0;
-    outStream.write(reinterpret_cast<const char *>(&archiveSize), (mustUse64Bit ? sizeof(uint64_t) : sizeof(uint32_t)));
-    // add number of directory entries to file
-    outStream.write(reinterpret_cast<const char *>(&nrOfEntries), sizeof(uint32_t));
-    // calculate data start offset behind directory
-    uint64_t dataStart = mustUse64Bit ? RES2H_HEADER_SIZE_64 : RES2H_HEADER_SIZE_32;
-    dataStart += directorySize;
-    // add directory for all files
-    for (const auto &file : fileList)
-    {
-        // add size of name
-        if (file.internalName.size() > UINT16_MAX)
-        {
-            std::cerr << "File name \"" << file.internalName << "\" is too long" << std::endl;
-            outStream.close();
+    if (!hybridArchivePath.empty())
+    {
+        for (auto &fileData : newList)
+        {
+            fileData.isArchived = fileData.size > hybridThreshold;
+        }
+    }
+    // find the files that need to be converted again. unchanged files keep their variable names and compressed size
+    std::set<stdfs::path> oldArchivedFiles;
+    for (const auto &fileData : fileList)
+    {
+        if (createBinary || fileData.isArchived)
+        {
+            oldArchivedFiles.insert(fileData.inPath);
+        }
+    }
+    std::set<stdfs::path> newArchivedFiles;
+    std::vector<std::size_t> convertIndices;
+    bool archiveChanged = false;
+    for (std::size_t index = 0; index < newList.size(); ++index)
+    {
+        auto &fileData = newList[index];
+        const auto oldIt = oldFiles.find(fileData.inPath);
+        const FileData *oldData = oldIt != oldFiles.cend() ? oldIt->second : nullptr;
+        const bool changed = convertAll || oldData == nullptr || oldData->size != fileData.size || changedPaths.count(fileData.inPath) > 0;
+        if (createBinary || fileData.isArchived)
+        {
+            newArchivedFiles.insert(fileData.inPath);
+            archiveChanged = archiveChanged || changed;
+            nrOfConverted += changed ? 1 : 0;
+        }
+        else if (changed || oldData->isArchived || oldData->outPath != fileData.outPath || oldData->isDuplicate != fileData.isDuplicate)
+        {
+            convertIndices.push_back(index);
+        }
+        else
+        {
+            fileData.dataVariableName = oldData->dataVariableName;
+            fileData.sizeVariableName = oldData->sizeVariableName;
+            fileData.compressedSize = oldData->compressedSize;
+        }
+    }
+    archiveChanged = archiveChanged || newArchivedFiles != oldArchivedFiles;
+    // convert changed files in parallel
+    if (!convertIndices.empty())
+    {
+        std::vector<FileData> convertList;
+        for (const auto index : convertIndices)
+        {
+            convertList.push_back(newList[index]);
+        }
+        Manifest manifest;
+        if (!convertFiles(convertList, commonHeaderFilePath, nrOfThreads, manifest, false))
+        {
             return false;
         }
-        const auto nameSize = static_cast<uint16_t>(file.internalName.size());
-        outStream.write(reinterpret_cast<const char *>(&nameSize), sizeof(uint16_t));
-        // add name
-        outStream.write(reinterpret_cast<const char *>(&file.internalName[0]), nameSize);
-        // add flags
-        const uint32_t entryFlags = 0;
-        outStream.write(reinterpret_cast<const char *>(&entryFlags), sizeof(uint32_t));
-        uint64_t fileChecksum = 0;
-        try
+        for (std::size_t i = 0; i < convertIndices.size(); ++i)
         {
-            fileChecksum = mustUse64Bit ? calculateFletcher<uint64_t>(file.inPath.string()) : calculateFletcher<uint32_t>(file.inPath.string());
+            newList[convertIndices[i]] = std::move(convertList[i]);
         }
-        catch (const std::runtime_error &e)
+        nrOfConverted += convertIndices.size();
+        if (compressData)
+        {
+            copyCompressedSizesToDuplicates(newList);
+        }
+    }
+    if (createBinary)
+    {
+        if (archiveChanged && !createBlob(newList, outFilePath, dataAlignment, nrOfThreads, beVerbose, statistics))
         {
-            std::cerr << "Failed to calculate file checksum: " << e.what() << std::endl;
             return false;
         }
-        // add data size, offset from file start to start of data and checksum
-        outStream.write(reinterpret_cast<const char *>(&file.size), (mustUse64Bit ? sizeof(uint64_t) : sizeof(uint32_t)));
-        outStream.write(reinterpret_cast<const char *>(&dataStart), (mustUse64Bit ? sizeof(uint64_t) : sizeof(uint32_t)));
-        outStream.write(reinterpret_cast<const char *>(&fileChecksum), (mustUse64Bit ? sizeof(uint64_t) : sizeof(uint32_t)));
-        IF_BEVERBOSE(std::cout << "Creating directory entry for \"" << file.internalName << "\"" << std::endl)
-        IF_BEVERBOSE(std::cout << "Data starts at " << std::dec << std::showbase << dataStart << " bytes" << std::endl)
-        IF_BEVERBOSE(std::cout << "Size is " << std::dec << file.size << " bytes" << std::endl)
-        IF_BEVERBOSE(std::cout << "Fletcher" << (mustUse64Bit ? "64" : "32") << " checksum is " << std::hex << std::showbase << fileChecksum << std::endl)
-        // now add size of this entries data to start offset for next data block
-        dataStart += file.size;
-    }
-    // add data for all files
-    for (const auto &file : fileList)
-    {
-        // try to open file
-        std::ifstream inStream;
-        inStream.open(file.inPath.string(), std::ios_base::in | std::ios_base::binary);
-        if (!inStream.is_open() || !inStream.good())
-        {
-            std::cerr << "Failed to open file \"" << file.inPath.string() << "\" for reading" << std::endl;
-            outStream.close();
+        if (!commonHeaderFilePath.empty() && !createIdHeader(newList, outFilePath, commonHeaderFilePath))
+        {
             return false;
         }
-        IF_BEVERBOSE(std::cout << "Adding data for \"" << file.internalName << "\"" << std::endl)
-        uint64_t overallDataSize = 0;
-        // copy data from input to output file
-        while (!inStream.eof() && inStream.good())
+    }
+    else
+    {
+        if (archiveChanged && !hybridArchivePath.empty())
         {
-            std::array<uint8_t, 4096> buffer{};
-            std::streamsize readSize = sizeof(buffer);
-            try
+            std::vector<FileData> archivedFiles;
+            std::copy_if(newList.cbegin(), newList.cend(), std::back_inserter(archivedFiles), [](const FileData &file) { return file.isArchived; });
+            if (!createBlob(archivedFiles, hybridArchivePath, dataAlignment, nrOfThreads, beVerbose, statistics))
             {
-                // try reading data from input file
-                inStream.read(reinterpret_cast<char *>(buffer.data()), sizeof(buffer));
+                return false;
             }
-            catch (const std::ios_base::failure & /*e*/)
+        }
+        // remove outputs of files that are gone, are archived now or are split into less chunks
+        if (!noData)
+        {
+            const auto newOutputPaths = sourceOutputPaths(newList);
+            for (const auto &outputPath : sourceOutputPaths(fileList))
             {
-                // if something other that EOF happended, this is a serious error
-                if (!inStream.eof())
+                if (newOutputPaths.count(outputPath) == 0)
                 {
-                    std::cerr << "While reading file \"" << file.inPath.string() << "\"" << std::endl;
-                    outStream.close();
-                    return false;
+                    IF_BEVERBOSE(std::cout << "Removing output file " << outputPath << std::endl)
+                    std::error_code error;
+                    stdfs::remove(outputPath, error);
                 }
             }
-            readSize = inStream.gcount();
-            // write to output file and increase size of overall data read
-            outStream.write(reinterpret_cast<const char *>(buffer.data()), readSize);
-            overallDataSize += static_cast<uint64_t>(readSize);
         }
-        // close input file
-        inStream.close();
-        // check if the file was completely read
-        if (overallDataSize != file.size)
+        if (!commonHeaderFilePath.empty() && !dataOnly)
         {
-            std::cerr << "Failed to completely copy file \"" << file.inPath.string() << "\" to binary data" << std::endl;
-            outStream.close();
-            return false;
+            if (!createCommonHeader(newList, commonHeaderFilePath, !utilitiesFilePath.empty(), useC))
+            {
+                return false;
+            }
+            if (!utilitiesFilePath.empty() && !createUtilities(newList, utilitiesFilePath, commonHeaderFilePath, combineResults))
+            {
+                return false;
+            }
         }
     }
-    // final archive size is current size + checksum. write size to the header now
-    archiveSize = static_cast<uint64_t>(outStream.tellg()) + (mustUse64Bit ? sizeof(uint64_t) : sizeof(uint32_t));
-    outStream.seekg(RES2H_OFFSET_ARCHIVE_SIZE);
-    outStream.write(reinterpret_cast<const char *>(&archiveSize), (mustUse64Bit ? sizeof(uint64_t) : sizeof(uint32_t)));
-    // close file
-    outStream.close();
-    IF_BEVERBOSE(std::cout << "Binary archive creation succeeded." << std::endl)
-    IF_BEVERBOSE(std::cout << "Archive has " << std::dec << archiveSize << " bytes." << std::endl)
-    // calculate checksum of whole file and append to file
-    uint64_t checksum = 0;
-    try
+    if (!depfilePath.empty() && !createDepfile(depfilePath, newList, directories))
     {
-        checksum = mustUse64Bit ? calculateFletcher<uint64_t>(filePath.string()) : calculateFletcher<uint32_t>(filePath.string());
+        return false;
     }
-    catch (const std::runtime_error &e)
+    fileList = std::move(newList);
+    return true;
+}
+
+static volatile std::sig_atomic_t stopWatching = 0;
+
+static void handleStopSignal(int /*signal*/)
+{
+    stopWatching = 1;
+}
+
+/// @brief Watch all directories using inotify and update the outputs when files change, until SIGINT or SIGTERM is received.
+/// Events are collected until no new events arrive for watchSettleMilliseconds, so files written or renamed
+/// in multiple steps, e.g. by editors, are only processed once.
+/// @param fileList Files converted by the initial run.
+/// @param directories Directories scanned by the initial run.
+static bool watchInputDirectory(std::vector<FileData> &fileList, std::vector<stdfs::path> &directories)
+{
+    static const int watchSettleMilliseconds = 20;
+    static const uint32_t watchMask = IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF;
+    const int inotifyFd = inotify_init1(IN_CLOEXEC);
+    if (inotifyFd < 0)
     {
-        std::cerr << "Failed to calculate archive checksum: " << e.what() << std::endl;
+        std::cerr << "Failed to initialize inotify: " << std::strerror(errno) << std::endl;
         return false;
     }
-    outStream.open(filePath.string(), std::ofstream::out | std::ofstream::binary | std::ofstream::app);
-    if (!outStream.is_open() || !outStream.good())
+    std::signal(SIGINT, handleStopSignal);
+    std::signal(SIGTERM, handleStopSignal);
+    // adding a watch for a directory again returns the same descriptor. descriptors of removed directories are dropped on IN_IGNORED
+    std::map<int, stdfs::path> watchedDirectories;
+    auto addWatches = [&]() {
+        std::set<stdfs::path> newDirectories;
+        for (const auto &directory : directories)
+        {
+            const int watchDescriptor = inotify_add_watch(inotifyFd, directory.c_str(), watchMask);
+            if (watchDescriptor < 0)
+            {
+                // the directory might have been removed since scanning. the next scan notices that
+                std::cerr << "Warning: Failed to watch directory " << directory << ": " << std::strerror(errno) << std::endl;
+                continue;
+            }
+            if (watchedDirectories.count(watchDescriptor) == 0)
+            {
+                newDirectories.insert(directory);
+            }
+            watchedDirectories[watchDescriptor] = directory;
+        }
+        return newDirectories;
+    };
+    addWatches();
+    std::cout << "Watching " << watchedDirectories.size() << " directories for changes. Press Ctrl+C to stop." << std::endl;
+    alignas(inotify_event) std::array<char, 64 * 1024> eventBuffer;
+    std::set<stdfs::path> newDirectories;
+    bool succeeded = true;
+    while (!stopWatching)
     {
-        std::cerr << "Failed to open file \"" << filePath.string() << "\" for writing" << std::endl;
-        return false;
+        // files in directories found by the last update may have been written before they were watched. check them again
+        std::set<stdfs::path> changedPaths;
+        for (const auto &fileData : fileList)
+        {
+            if (newDirectories.count(fileData.inPath.parent_path()) > 0)
+            {
+                changedPaths.insert(fileData.inPath);
+            }
+        }
+        // block until the first event, then collect events until the input tree is quiet
+        bool convertAll = false;
+        bool hasEvents = !newDirectories.empty();
+        int timeout = hasEvents ? watchSettleMilliseconds : -1;
+        while (!stopWatching)
+        {
+            pollfd pollInfo = {inotifyFd, POLLIN, 0};
+            const int result = poll(&pollInfo, 1, timeout);
+            if (result == 0)
+            {
+                break;
+            }
+            const auto length = result > 0 ? read(inotifyFd, eventBuffer.data(), eventBuffer.size()) : -1;
+            if (length < 0)
+            {
+                if (errno == EINTR || errno == EAGAIN)
+                {
+                    continue;
+                }
+                std::cerr << "Failed to read inotify events: " << std::strerror(errno) << std::endl;
+                stopWatching = 1;
+                succeeded = false;
+                break;
+            }
+            for (auto eventIt = eventBuffer.data(); eventIt < eventBuffer.data() + length;)
+            {
+                const auto event = reinterpret_cast<const inotify_event *>(eventIt);
+                eventIt += sizeof(inotify_event) + event->len;
+                if ((event->mask & IN_IGNORED) != 0)
+                {
+                    watchedDirectories.erase(event->wd);
+                    continue;
+                }
+                hasEvents = true;
+                if ((event->mask & IN_Q_OVERFLOW) != 0)
+                {
+                    // events were lost. we can't tell which files changed
+                    convertAll = true;
+                }
+                const auto directoryIt = watchedDirectories.find(event->wd);
+                if (event->len > 0 && (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) != 0 && directoryIt != watchedDirectories.cend())
+                {
+                    changedPaths.insert(directoryIt->second / event->name);
+                }
+            }
+            timeout = watchSettleMilliseconds;
+        }
+        if (stopWatching || !hasEvents)
+        {
+            continue;
+        }
+        // only the statistics of the last update are kept
+        statistics = Stats();
+        const auto start = std::chrono::steady_clock::now();
+        std::size_t nrOfConverted = 0;
+        bool updated = false;
+        try
+        {
+            updated = updateOutputs(fileList, directories, changedPaths, convertAll, nrOfConverted);
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << "Failed to update outputs: " << e.what() << std::endl;
+        }
+        // new directories need watches too
+        newDirectories = addWatches();
+        if (updated)
+        {
+            std::cout << "Updated outputs in " << std::fixed << std::setprecision(1) << secondsSince(start) * 1000.0 << " ms. Converted " << nrOfConverted << " of " << fileList.size() << " files." << std::endl;
+        }
+        else
+        {
+            // a file might have been read while it was written. try again on the next change
+            std::cerr << "Failed to update outputs. Waiting for the next change" << std::endl;
+        }
     }
-    outStream.seekg(0, std::ios::end);
-    outStream.write(reinterpret_cast<const char *>(&checksum), (mustUse64Bit ? sizeof(uint64_t) : sizeof(uint32_t)));
-    outStream.close();
-    IF_BEVERBOSE(std::cout << "Archive Fletcher" << (mustUse64Bit ? "64" : "32") << " checksum is " << std::hex << std::showbase << checksum << "." << std::endl)
-    return true;
+    close(inotifyFd);
+    std::cout << "Stopped watching for changes." << std::endl;
+    return succeeded;
 }
+#endif
 
 int main(int argc, const char *argv[])
 {
@@ -704,12 +2053,36 @@ int main(int argc, const char *argv[])
         printUsage();
         return 2;
     }
+    const auto runStart = std::chrono::steady_clock::now();
     // check if the input path exist
-    if (!stdfs::exists(inFilePath))
+    if (inFilePath != stdinPath && !stdfs::exists(inFilePath))
     {
         std::cerr << "Invalid input file/directory " << inFilePath << std::endl;
         return 1;
     }
+    // stdin and pipes are read once while converting, because their size is not known before
+    const bool streamInput = inFilePath == stdinPath || (!stdfs::is_regular_file(inFilePath) && !stdfs::is_directory(inFilePath));
+    if (streamInput && (appendFile || combineResults || noData || !manifestFilePath.empty() || compressData || shardSize > 0 || outputMode == OutputMode::Elf || outputMode == OutputMode::Asm))
+    {
+        std::cerr << "Reading from stdin or a pipe can not be combined with -a, -1, -m elf, -m asm, --no-data, --manifest, --compress or --shard-size" << std::endl;
+        return 1;
+    }
+    if (!internalNameOption.empty() && stdfs::is_directory(inFilePath))
+    {
+        std::cerr << "Option --name can only be used with a single input file" << std::endl;
+        return 1;
+    }
+    if (watchForChanges && !stdfs::is_directory(inFilePath))
+    {
+        std::cerr << "Option --watch needs an input directory" << std::endl;
+        return 1;
+    }
+    if (!hybridArchivePath.empty() && !stdfs::is_directory(inFilePath))
+    {
+        // Res2h only looks up names starting with ":/" in archives
+        std::cerr << "Option --hybrid needs an input directory" << std::endl;
+        return 1;
+    }
     if (createBinary)
     {
         // check if argument 2 is a file
@@ -740,12 +2113,17 @@ int main(int argc, const char *argv[])
         std::cerr << "Input and output file must be both either a file or a directory" << std::endl;
         return 1;
     }
+    // build list of files to process
+    std::vector<FileData> fileList;
+    std::vector<stdfs::path> directories;
     if (appendFile)
     {
         // append file a to b
         try
         {
+            const auto start = std::chrono::steady_clock::now();
             appendFileContent(outFilePath, inFilePath);
+            statistics.phases.push_back({"append", secondsSince(start), static_cast<uint64_t>(stdfs::file_size(inFilePath))});
         }
         catch (const std::runtime_error &e)
         {
@@ -755,19 +2133,42 @@ int main(int argc, const char *argv[])
     }
     else
     {
-        // build list of files to process
-        std::vector<FileData> fileList;
         if (stdfs::is_directory(inFilePath))
         {
             // both files are directories, build file ist
-            fileList = getFileData(inFilePath, inFilePath, useRecursion);
+            auto start = std::chrono::steady_clock::now();
+            fileList = getFileData(inFilePath, inFilePath, useRecursion, beVerbose, nrOfThreads, &directories);
+            const auto bytesFound = std::accumulate(fileList.cbegin(), fileList.cend(), static_cast<uint64_t>(0), [](uint64_t sum, const FileData &file) { return sum + file.size; });
+            statistics.phases.push_back({"scan and sort", secondsSince(start), bytesFound});
             if (fileList.empty())
             {
                 std::cerr << "Found no files to convert" << std::endl;
                 return 1;
             }
-            fileList = naiveSortByInPath(fileList);
-            fileList = generateOutputPaths(fileList, inFilePath, outFilePath, useC, beVerbose);
+            // transformed sizes are needed from here on, e.g. to find duplicates
+            if (!transformFiles(fileList, nrOfThreads))
+            {
+                return 1;
+            }
+            start = std::chrono::steady_clock::now();
+            generateOutputPaths(fileList, inFilePath, outFilePath, outputFileExtension(), beVerbose);
+            statistics.phases.push_back({"output paths", secondsSince(start), 0});
+            if (deduplicate)
+            {
+                try
+                {
+                    start = std::chrono::steady_clock::now();
+                    const auto bytesSaved = markDuplicates(fileList, beVerbose);
+                    statistics.phases.push_back({"dedup", secondsSince(start), 0});
+                    const auto nrOfDuplicates = std::count_if(fileList.cbegin(), fileList.cend(), [](const FileData &file) { return file.isDuplicate; });
+                    IF_BEVERBOSE(std::cout << "Found " << nrOfDuplicates << " duplicate files. Saved " << bytesSaved << " bytes." << std::endl)
+                }
+                catch (const std::runtime_error &e)
+                {
+                    std::cerr << "Failed to find duplicate files: " << e.what() << std::endl;
+                    return 1;
+                }
+            }
         }
         else
         {
@@ -775,32 +2176,64 @@ int main(int argc, const char *argv[])
             FileData temp;
             temp.inPath = inFilePath;
             temp.outPath = outFilePath;
+            temp.isStream = streamInput;
             temp.internalName = inFilePath.filename().string(); // remove all, but the file name and extension
+            if (inFilePath == stdinPath)
+            {
+                // stdin has no name. use the output file name without extension
+                temp.internalName = outFilePath.stem().string();
+            }
+            if (!internalNameOption.empty())
+            {
+                temp.internalName = internalNameOption;
+            }
             IF_BEVERBOSE(std::cout << "Found input file " << inFilePath << std::endl)
             IF_BEVERBOSE(std::cout << "Internal name will be \"" << temp.internalName << "\"" << std::endl)
             IF_BEVERBOSE(std::cout << "Output path is " << temp.outPath << std::endl)
-            // get file size
-            try
+            // get file size. the size of streams is known after reading them
+            if (streamInput)
             {
-                temp.size = static_cast<uint64_t>(stdfs::file_size(inFilePath));
-                IF_BEVERBOSE(std::cout << "Size is " << temp.size << " bytes." << std::endl)
+                IF_BEVERBOSE(std::cout << "Reading data from stream." << std::endl)
             }
-            catch (const stdfs::filesystem_error &e)
+            else
             {
-                std::cerr << "Failed to get size of " << inFilePath << ": " << e.what() << std::endl;
-                temp.size = 0;
+                try
+                {
+                    temp.size = static_cast<uint64_t>(stdfs::file_size(inFilePath));
+                    IF_BEVERBOSE(std::cout << "Size is " << temp.size << " bytes." << std::endl)
+                }
+                catch (const stdfs::filesystem_error &e)
+                {
+                    std::cerr << "Failed to get size of " << inFilePath << ": " << e.what() << std::endl;
+                    temp.size = 0;
+                }
             }
             fileList.push_back(temp);
+            if (!transformFiles(fileList, 1))
+            {
+                return 1;
+            }
         }
         // does the user want an binary file?
         if (createBinary)
         {
             // yes. build it.
-            if (!createBlob(fileList, outFilePath))
+            if (!createBlob(fileList, outFilePath, dataAlignment, nrOfThreads, beVerbose, statistics))
             {
                 std::cerr << "Failed to convert to binary file" << std::endl;
                 return 1;
             }
+            // write the IDs of all resources for Res2h::loadResource()
+            if (!commonHeaderFilePath.empty())
+            {
+                const auto start = std::chrono::steady_clock::now();
+                if (!createIdHeader(fileList, outFilePath, commonHeaderFilePath))
+                {
+                    std::cerr << "Failed to create resource ID header" << std::endl;
+                    return 1;
+                }
+                statistics.phases.push_back({"header", secondsSince(start), 0});
+            }
         }
         else
         {
@@ -808,31 +2241,90 @@ int main(int argc, const char *argv[])
             // That is not caught before the end of main(). Make sure they don't.
             try
             {
-                // no. convert files to .c/.cpp. loop through list, converting files
-                for (auto fdIt = fileList.begin(); fdIt != fileList.cend(); ++fdIt)
+                // read manifest of last run if the user wants to skip unchanged files
+                Manifest manifest;
+                if (!manifestFilePath.empty())
+                {
+                    try
+                    {
+                        const auto start = std::chrono::steady_clock::now();
+                        manifest = readManifest(manifestFilePath);
+                        statistics.phases.push_back({"read manifest", secondsSince(start), 0});
+                    }
+                    catch (const std::runtime_error &e)
+                    {
+                        std::cerr << "Warning: Failed to read manifest " << manifestFilePath << ": " << e.what() << ". Converting all files" << std::endl;
+                    }
+                    // if options changed, all files need to be converted again
+                    if (manifest.options != manifestOptions())
+                    {
+                        manifest.options = manifestOptions();
+                        manifest.entries.clear();
+                    }
+                }
+                // with --hybrid files bigger than the threshold go to the archive instead of data arrays
+                if (!hybridArchivePath.empty())
+                {
+                    for (auto &fileData : fileList)
+                    {
+                        fileData.isArchived = fileData.size > hybridThreshold;
+                    }
+                }
+                // convert files to .c/.cpp. this fills in the variable names needed for header and utilities
+                if (!convertFiles(fileList, commonHeaderFilePath, nrOfThreads, manifest, !manifestFilePath.empty()))
+                {
+                    std::cerr << "Failed to convert all files. Aborting" << std::endl;
+                    return 1;
+                }
+                if (!hybridArchivePath.empty())
                 {
-                    if (!convertFile(*fdIt, commonHeaderFilePath))
+                    std::vector<FileData> archivedFiles;
+                    std::copy_if(fileList.cbegin(), fileList.cend(), std::back_inserter(archivedFiles), [](const FileData &file) { return file.isArchived; });
+                    IF_BEVERBOSE(std::cout << std::endl
+                                           << "Storing " << archivedFiles.size() << " files bigger than " << hybridThreshold << " bytes in archive " << hybridArchivePath << std::endl)
+                    if (!createBlob(archivedFiles, hybridArchivePath, dataAlignment, nrOfThreads, beVerbose, statistics))
                     {
-                        std::cerr << "Failed to convert all files. Aborting" << std::endl;
+                        std::cerr << "Failed to create archive " << hybridArchivePath << std::endl;
                         return 1;
                     }
                 }
                 // do we need to write a header file?
-                if (!commonHeaderFilePath.empty())
+                if (!commonHeaderFilePath.empty() && !dataOnly)
                 {
+                    auto start = std::chrono::steady_clock::now();
                     if (!createCommonHeader(fileList, commonHeaderFilePath, !utilitiesFilePath.empty(), useC))
                     {
                         std::cerr << "Failed to create common header file" << std::endl;
                         return 1;
                     }
+                    statistics.phases.push_back({"header", secondsSince(start), 0});
                     // do we need to create utilities?
                     if (!utilitiesFilePath.empty())
                     {
-                        if (!createUtilities(fileList, utilitiesFilePath, commonHeaderFilePath, useC, combineResults))
+                        start = std::chrono::steady_clock::now();
+                        if (!createUtilities(fileList, utilitiesFilePath, commonHeaderFilePath, combineResults))
                         {
                             std::cerr << "Failed to create utilities file" << std::endl;
                             return 1;
                         }
+                        // with -1 the data is converted again into the utilities file
+                        const auto bytesCombined = combineResults ? std::accumulate(fileList.cbegin(), fileList.cend(), static_cast<uint64_t>(0), [](uint64_t sum, const FileData &file) { return sum + (file.isDuplicate ? 0 : file.size); }) : 0;
+                        statistics.phases.push_back({"utilities", secondsSince(start), bytesCombined});
+                    }
+                }
+                // store state of files for the next run
+                if (!manifestFilePath.empty())
+                {
+                    try
+                    {
+                        const auto start = std::chrono::steady_clock::now();
+                        writeManifest(manifestFilePath, manifest);
+                        statistics.phases.push_back({"write manifest", secondsSince(start), 0});
+                    }
+                    catch (const std::runtime_error &e)
+                    {
+                        std::cerr << "Failed to write manifest " << manifestFilePath << ": " << e.what() << std::endl;
+                        return 1;
                     }
                 }
             }
@@ -840,8 +2332,38 @@ int main(int argc, const char *argv[])
             {
             }
         }
+        // write dependencies for the build system
+        if (!depfilePath.empty() && !createDepfile(depfilePath, fileList, directories))
+        {
+            std::cerr << "Failed to create depfile" << std::endl;
+            return 1;
+        }
+    }
+    // report where the time went
+    statistics.phases.push_back({"total", secondsSince(runStart), 0});
+    if (printStatistics)
+    {
+        printStats(std::cout, statistics, statsNrOfSlowestFiles);
+    }
+    if (!statsJsonPath.empty())
+    {
+        try
+        {
+            writeStatsJson(statsJsonPath, statistics, statsNrOfSlowestFiles);
+        }
+        catch (const std::runtime_error &e)
+        {
+            std::cerr << "Failed to write statistics " << statsJsonPath << ": " << e.what() << std::endl;
+            return 1;
+        }
     }
     // profit!!!
     std::cout << "res2h succeeded." << std::endl;
+#if defined(__linux__)
+    if (watchForChanges)
+    {
+        return watchInputDirectory(fileList, directories) ? 0 : 1;
+    }
+#endif
     return 0;
 }
@@ -22,6 +22,11 @@
 #define RES2H_OFFSET_NO_OF_FILES_64 (sizeof(RES2H_MAGIC_BYTES) - 1 + 16)
 #define RES2H_OFFSET_DIR_START_64 (sizeof(RES2H_MAGIC_BYTES) - 1 + 24)
 
+// the low 8 bit of the format flags hold the archive bit depth, the next 8 bit log2 of the alignment of entry data
+#define RES2H_FORMAT_BITS_MASK 0x000000FF
+#define RES2H_FORMAT_ALIGNMENT_SHIFT 8
+#define RES2H_FORMAT_ALIGNMENT_MASK 0x0000FF00
+
 #define RES2H_HEADER_SIZE_32 24
 #define RES2H_HEADER_SIZE_64 28
 #define RES2H_DIRECTORY_SIZE_32 18
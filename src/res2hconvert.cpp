@@ -0,0 +1,1015 @@
+#include "res2hconvert.h"
+#include "res2h.h"
+#include "checksum.h"
+#include "elfwriter.h"
+#include "lz4.h"
+#include "stdfshelpers.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <thread>
+
+const stdfs::path stdinPath = "-";
+
+const std::string indent = "    ";
+static const uint32_t convertBytesPerLine = 14; // number of bytes per line in converted data
+static const uint32_t stringBytesPerLine = 64; // number of bytes per line in string literal data
+static const std::size_t convertReadBufferSize = 256 * 1024; // size of the input buffer used when converting data
+static const std::size_t archiveCopyBufferSize = 256 * 1024; // size of the buffer used when copying data to archives
+static const uint64_t archiveBlockSize = 1024 * 1024; // maximum size of the blocks files are split into when copying data to archives in parallel
+static const uint64_t kernelCopyMinSize = 64 * 1024; // smaller files are written to archives from the buffer they're checksummed in
+static const uint64_t unknownSize = UINT64_MAX; // size passed to the data writers to read a stream until its end
+
+/// @brief Build a table holding the "0xNN," string for every possible byte value.
+static std::array<std::array<char, 5>, 256> createHexByteTable()
+{
+    static const char hexDigits[] = "0123456789abcdef";
+    std::array<std::array<char, 5>, 256> table{};
+    for (std::size_t i = 0; i < table.size(); ++i)
+    {
+        table[i] = {'0', 'x', hexDigits[i >> 4], hexDigits[i & 0x0F], ','};
+    }
+    return table;
+}
+
+static const std::array<std::array<char, 5>, 256> hexByteTable = createHexByteTable();
+
+/// @brief A byte as it needs to be written in a C string literal.
+struct EscapedByte
+{
+    std::array<char, 4> chars;
+    uint8_t length;
+};
+
+/// @brief Build a table holding the escaped string literal representation for every possible byte value.
+/// Printable characters are written as-is, all others as 3-digit octal escape sequences. Octal escapes
+/// end after 3 digits, so a following digit can not be mistaken as part of the sequence like with hex escapes.
+static std::array<EscapedByte, 256> createEscapedByteTable()
+{
+    std::array<EscapedByte, 256> table{};
+    for (std::size_t i = 0; i < table.size(); ++i)
+    {
+        const auto c = static_cast<char>(i);
+        if (c == '"' || c == '\\' || c == '?')
+        {
+            // escape quotes, backslashes and question marks (which could start a trigraph)
+            table[i] = {{'\\', c, 0, 0}, 2};
+        }
+        else if (c == '\n')
+        {
+            table[i] = {{'\\', 'n', 0, 0}, 2};
+        }
+        else if (i >= 0x20 && i < 0x7F)
+        {
+            table[i] = {{c, 0, 0, 0}, 1};
+        }
+        else
+        {
+            table[i] = {{'\\', static_cast<char>('0' + (i >> 6)), static_cast<char>('0' + ((i >> 3) & 0x07)), static_cast<char>('0' + (i & 0x07))}, 4};
+        }
+    }
+    return table;
+}
+
+static const std::array<EscapedByte, 256> escapedByteTable = createEscapedByteTable();
+
+/// @brief Read size bytes from inStream in large blocks, let encodeBlock convert them to text and write the text to outStream.
+/// @param maxCharsPerByte Maximum number of characters encodeBlock writes for one input byte.
+/// @param encodeBlock Function converting the bytes [first, last) into text at out. Returns the end of the written text.
+/// @return Returns the number of bytes converted. Pass unknownSize as size to convert until the end of inStream.
+template <typename ENCODER>
+static uint64_t encodeData(std::istream &inStream, std::ostream &outStream, uint64_t size, std::size_t maxCharsPerByte, ENCODER encodeBlock)
+{
+    std::vector<char> inBuffer(convertReadBufferSize);
+    std::vector<char> outBuffer(convertReadBufferSize * maxCharsPerByte);
+    uint64_t bytesConverted = 0;
+    while (bytesConverted < size && inStream.good())
+    {
+        // read block from source
+        inStream.read(inBuffer.data(), static_cast<std::streamsize>(std::min(static_cast<uint64_t>(inBuffer.size()), size - bytesConverted)));
+        const auto readSize = static_cast<std::size_t>(inStream.gcount());
+        if (readSize == 0)
+        {
+            // we failed to read. break the read loop and close the file.
+            break;
+        }
+        bytesConverted += readSize;
+        // convert and write block to destination
+        const char *out = encodeBlock(reinterpret_cast<const uint8_t *>(inBuffer.data()), reinterpret_cast<const uint8_t *>(inBuffer.data()) + readSize, outBuffer.data());
+        outStream.write(outBuffer.data(), out - outBuffer.data());
+    }
+    return bytesConverted;
+}
+
+/// @brief Write size bytes from inStream to outStream as comma-separated hex values for an array initializer.
+/// With unknownSize every value is followed by a comma, which is allowed in initializers.
+/// @return Returns the number of bytes written.
+static uint64_t writeHexData(std::istream &inStream, std::ostream &outStream, uint64_t size)
+{
+    outStream << indent; // first indent
+    // the worst case for every byte is "0xNN," followed by a line break and the indent
+    uint64_t bytesConverted = 0;
+    return encodeData(inStream, outStream, size, 5 + 1 + indent.size(), [&](const uint8_t *first, const uint8_t *last, char *out) {
+        for (; first != last; ++first)
+        {
+            const auto &hexByte = hexByteTable[*first];
+            // was this the last character?
+            if (++bytesConverted < size)
+            {
+                // no. add byte with comma.
+                std::memcpy(out, hexByte.data(), hexByte.size());
+                out += hexByte.size();
+                // add break after 14 bytes and add indent again
+                if (bytesConverted % convertBytesPerLine == 0)
+                {
+                    *out++ = '\n';
+                    std::memcpy(out, indent.data(), indent.size());
+                    out += indent.size();
+                }
+            }
+            else
+            {
+                // yes. add byte without comma.
+                std::memcpy(out, hexByte.data(), hexByte.size() - 1);
+                out += hexByte.size() - 1;
+            }
+        }
+        return out;
+    });
+}
+
+/// @brief Write size bytes from inStream to outStream as a sequence of escaped string literals, one per line.
+/// The compiler concatenates adjacent string literals, but parses them much faster than an initializer list.
+/// @return Returns the number of bytes written.
+static uint64_t writeStringData(std::istream &inStream, std::ostream &outStream, uint64_t size)
+{
+    outStream << indent << "\""; // first indent and quote
+    // the worst case for every byte is an escape sequence followed by closing the literal, a line break, the indent and a new quote
+    uint64_t bytesConverted = 0;
+    const auto bytesWritten = encodeData(inStream, outStream, size, 4 + 2 + indent.size() + 1, [&](const uint8_t *first, const uint8_t *last, char *out) {
+        for (; first != last; ++first)
+        {
+            // start a new literal on a new line every couple of bytes
+            if (bytesConverted > 0 && bytesConverted % stringBytesPerLine == 0)
+            {
+                *out++ = '"';
+                *out++ = '\n';
+                std::memcpy(out, indent.data(), indent.size());
+                out += indent.size();
+                *out++ = '"';
+            }
+            const auto &escapedByte = escapedByteTable[*first];
+            std::memcpy(out, escapedByte.chars.data(), escapedByte.length);
+            out += escapedByte.length;
+            ++bytesConverted;
+        }
+        return out;
+    });
+    outStream << "\""; // closing quote
+    return bytesWritten;
+}
+
+/// @brief Return the number of bytes of the smallest unsigned type that can hold size.
+static uint32_t sizeTypeBytes(uint64_t size)
+{
+    if (size <= UINT16_MAX)
+    {
+        return sizeof(uint16_t);
+    }
+    if (size <= UINT32_MAX)
+    {
+        return sizeof(uint32_t);
+    }
+    return sizeof(uint64_t);
+}
+
+/// @brief Return the name of the ELF section holding the data array name. With --sections every array gets its own section.
+static std::string dataSectionName(const std::string &name, bool useSections)
+{
+    return useSections ? ".rodata.res2h." + name : ".rodata";
+}
+
+/// @brief Write an assembler file that defines the size and data variables and includes the input file using .incbin.
+/// The file needs to go through the C preprocessor, so symbol prefixes and sections work for ELF, Mach-O and COFF targets.
+static void writeAsmData(std::ostream &outStream, const FileData &fileData, const ConvertOptions &options)
+{
+    static const std::array<const char *, 9> sizeDirectives = {"", "", ".short", "", ".long", "", "", "", ".quad"};
+    const auto sizeBytes = sizeTypeBytes(fileData.size);
+    // the assembler needs an absolute path to find the input file
+    std::string inPath = stdfs::absolute(fileData.inPath).generic_string();
+    for (std::size_t pos = 0; (pos = inPath.find_first_of("\"\\", pos)) != std::string::npos; pos += 2)
+    {
+        inPath.insert(pos, 1, '\\');
+    }
+    outStream << "/* this file was auto-generated from \"" << fileData.inPath.filename().string() << "\" by res2h */" << std::endl;
+    outStream << "/* assemble it using your C compiler, so it runs through the preprocessor */" << std::endl
+              << std::endl;
+    outStream << "#define RES2H_CONCAT_(a, b) a##b" << std::endl;
+    outStream << "#define RES2H_CONCAT(a, b) RES2H_CONCAT_(a, b)" << std::endl;
+    outStream << "#define RES2H_SYMBOL(name) RES2H_CONCAT(__USER_LABEL_PREFIX__, name)" << std::endl
+              << std::endl;
+    outStream << "#if defined(__APPLE__)" << std::endl;
+    outStream << indent << ".const" << std::endl;
+    outStream << "#elif defined(_WIN32)" << std::endl;
+    outStream << indent << ".section .rdata,\"dr\"" << std::endl;
+    outStream << "#else" << std::endl;
+    outStream << indent << ".section " << dataSectionName(fileData.dataVariableName, options.useSections) << ",\"a\"" << std::endl;
+    outStream << "#endif" << std::endl;
+    for (const auto &symbol : {fileData.sizeVariableName, fileData.dataVariableName})
+    {
+        outStream << indent << ".globl RES2H_SYMBOL(" << symbol << ")" << std::endl;
+        outStream << "#if defined(__ELF__)" << std::endl;
+        outStream << indent << ".type RES2H_SYMBOL(" << symbol << "), %object" << std::endl;
+        outStream << indent << ".size RES2H_SYMBOL(" << symbol << "), " << (symbol == fileData.sizeVariableName ? sizeBytes : fileData.size) << std::endl;
+        outStream << "#endif" << std::endl;
+    }
+    outStream << indent << ".balign 8" << std::endl;
+    outStream << "RES2H_SYMBOL(" << fileData.sizeVariableName << "):" << std::endl;
+    outStream << indent << sizeDirectives[sizeBytes] << " " << std::dec << fileData.size << std::endl;
+    outStream << indent << ".balign " << std::max(options.dataAlignment, static_cast<uint64_t>(8)) << std::endl;
+    outStream << "RES2H_SYMBOL(" << fileData.dataVariableName << "):" << std::endl;
+    outStream << indent << ".incbin \"" << inPath << "\"" << std::endl
+              << std::endl;
+    // mark the stack as non-executable, else the linker may complain
+    outStream << "#if defined(__ELF__)" << std::endl;
+    outStream << indent << ".section .note.GNU-stack,\"\",%progbits" << std::endl;
+    outStream << "#endif" << std::endl;
+}
+
+void createVariableNames(FileData &fileData)
+{
+    fileData.dataVariableName = fileData.outPath.filename().stem().string() + "_data";
+    fileData.sizeVariableName = fileData.outPath.filename().stem().string() + "_size";
+}
+
+stdfs::path temporaryPath(const stdfs::path &outPath)
+{
+    return outPath.string() + ".tmp";
+}
+
+bool finishOutputFile(std::ofstream &outStream, const stdfs::path &outPath, bool beVerbose, std::ostream &infoStream, std::ostream &errorStream)
+{
+    outStream.close();
+    if (outStream.fail())
+    {
+        errorStream << "Failed to write file \"" << temporaryPath(outPath).string() << "\"" << std::endl;
+        return false;
+    }
+    try
+    {
+        if (!replaceFileIfChanged(outPath, temporaryPath(outPath)))
+        {
+            IF_BEVERBOSE(infoStream << " - unchanged")
+        }
+    }
+    catch (const std::runtime_error &e)
+    {
+        errorStream << "Failed to replace file \"" << outPath.string() << "\": " << e.what() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+std::string sizeTypeName(uint64_t size)
+{
+    return "uint" + std::to_string(sizeTypeBytes(size) * 8) + "_t";
+}
+
+uint64_t nrOfChunks(const FileData &fileData, uint64_t shardSize)
+{
+    return (shardSize == 0 || fileData.size <= shardSize) ? 1 : (fileData.size + shardSize - 1) / shardSize;
+}
+
+uint64_t chunkSize(const FileData &fileData, uint64_t chunkIndex, uint64_t shardSize)
+{
+    return nrOfChunks(fileData, shardSize) == 1 ? fileData.size : std::min(shardSize, fileData.size - chunkIndex * shardSize);
+}
+
+std::string chunkVariableName(const FileData &fileData, uint64_t chunkIndex)
+{
+    return fileData.dataVariableName + "_" + std::to_string(chunkIndex);
+}
+
+std::string compressedSizeVariableName(const FileData &fileData)
+{
+    return fileData.outPath.filename().stem().string() + "_compressed_size";
+}
+
+std::string segmentsVariableName(const FileData &fileData)
+{
+    return fileData.outPath.filename().stem().string() + "_segments";
+}
+
+stdfs::path chunkOutputPath(const FileData &fileData, uint64_t chunkIndex)
+{
+    if (chunkIndex == 0)
+    {
+        return fileData.outPath;
+    }
+    auto chunkPath = fileData.outPath;
+    return chunkPath.replace_filename(fileData.outPath.stem().string() + "_" + std::to_string(chunkIndex) + fileData.outPath.extension().string());
+}
+
+/// @brief Write the comment and the include of the common header at the start of a source file.
+static void writeSourceHeader(std::ostream &outStream, const FileData &fileData, const stdfs::path &outPath, const stdfs::path &commonHeaderPath, const ConvertOptions &options)
+{
+    // add message
+    outStream << "// this file was auto-generated from \"" << fileData.inPath.filename().string() << "\" by res2h" << std::endl
+              << std::endl;
+    // add header include
+    if (!commonHeaderPath.empty())
+    {
+        // common header path must be relative to destination directory
+        stdfs::path relativeHeaderPath = naiveRelative(commonHeaderPath, outPath);
+        outStream << "#include \"" << relativeHeaderPath.generic_string() << "\"" << std::endl
+                  << std::endl;
+    }
+    else if (options.registerEntries)
+    {
+        // registered files are used without a header, so they need the integer types themselves
+        outStream << (options.useC ? "#include <stdint.h>" : "#include <cstdint>") << std::endl
+                  << std::endl;
+    }
+}
+
+void writeSectionAttribute(std::ostream &outStream, const std::string &sectionName, const ConvertOptions &options)
+{
+    if (options.useSections)
+    {
+        // section attributes are a GNU extension and only ELF allows arbitrary section names
+        outStream << "#if defined(__ELF__)" << std::endl;
+        outStream << "__attribute__((section(\"" << sectionName << "\")))" << std::endl;
+        outStream << "#endif" << std::endl;
+    }
+}
+
+/// @brief Write the entry of a file into the "res2h_entries" section for --register. The entry is static,
+/// so it has no symbol. The linker keeps it, because the runtime in res2hregistry.c references the section.
+static void writeRegistryEntry(std::ostream &outStream, const FileData &fileData)
+{
+    // same definition as in res2hregistry.h, so generated files need no include path
+    outStream << "#ifndef RES2H_REGISTRY_ENTRY_DEFINED" << std::endl;
+    outStream << "#define RES2H_REGISTRY_ENTRY_DEFINED" << std::endl;
+    outStream << "typedef struct Res2hRegistryEntry" << std::endl;
+    outStream << "{" << std::endl;
+    outStream << indent << "const char * relativeFileName;" << std::endl;
+    outStream << indent << "uint64_t size;" << std::endl;
+    outStream << indent << "const uint8_t * data;" << std::endl;
+    outStream << "} Res2hRegistryEntry;" << std::endl;
+    outStream << "#endif" << std::endl;
+    // only ELF has __start_ / __stop_ symbols for sections. the runtime walks the section as an array, so the compiler
+    // must not align entries to more than their size, which it does for bigger objects unless the alignment is given
+    outStream << "#if defined(__ELF__)" << std::endl;
+    outStream << "static const Res2hRegistryEntry " << fileData.outPath.filename().stem().string() << "_entry __attribute__((used, section(\"res2h_entries\"), aligned(8))) = {\"" << fileData.internalName << "\", " << std::dec << fileData.size << ", " << fileData.dataVariableName << "};" << std::endl;
+    outStream << "#endif" << std::endl
+              << std::endl;
+}
+
+/// @brief Write the start of the definition of the data array name with the dimension arraySize, including alignment and section attributes.
+static void writeDataArrayDeclaration(std::ostream &outStream, const std::string &name, const std::string &arraySize, const ConvertOptions &options)
+{
+    writeSectionAttribute(outStream, dataSectionName(name, options.useSections), options);
+    if (options.dataAlignment > 0 && !options.useC)
+    {
+        outStream << "alignas(" << options.dataAlignment << ") ";
+    }
+    outStream << "const uint8_t " << name << "[" << arraySize << "]";
+    if (options.dataAlignment > 0 && options.useC)
+    {
+        outStream << " __attribute__((aligned(" << options.dataAlignment << ")))";
+    }
+}
+
+/// @brief Write an array definition holding the next size bytes from inStream in the current output mode.
+/// With unknownSize all data up to the end of inStream is written and the compiler determines the array size.
+/// @return Returns the number of bytes written.
+static uint64_t writeDataArray(std::istream &inStream, std::ostream &outStream, const std::string &name, uint64_t size, const ConvertOptions &options)
+{
+    uint64_t bytesWritten = 0;
+    if (options.outputMode == OutputMode::String)
+    {
+        // string literals always have a terminating zero, so the array needs an extra byte
+        writeDataArrayDeclaration(outStream, name, size == unknownSize ? "" : std::to_string(size) + " + 1", options);
+        outStream << " =" << std::endl;
+        bytesWritten = writeStringData(inStream, outStream, size);
+        outStream << ";" << std::endl
+                  << std::endl;
+    }
+    else
+    {
+        writeDataArrayDeclaration(outStream, name, size == unknownSize ? "" : std::to_string(size), options);
+        outStream << " = {" << std::endl;
+        bytesWritten = writeHexData(inStream, outStream, size);
+        if (bytesWritten == 0 && size == unknownSize)
+        {
+            // arrays can not be empty
+            outStream << "0";
+        }
+        // add closing curly braces
+        outStream << std::endl
+                  << "};" << std::endl
+                  << std::endl;
+    }
+    return bytesWritten;
+}
+
+void writeChunk(std::istream &inStream, std::ostream &outStream, const FileData &fileData, uint64_t chunkIndex, const ConvertOptions &options)
+{
+    const auto chunks = nrOfChunks(fileData, options.shardSize);
+    if (chunkIndex == 0)
+    {
+        outStream << "const " << sizeTypeName(fileData.size) << " " << fileData.sizeVariableName << " = " << std::dec << fileData.size << ";" << std::endl;
+    }
+    if (chunks == 1 && options.compressData)
+    {
+        // inStream holds compressed data. the size variable stays the uncompressed size
+        outStream << "const " << sizeTypeName(fileData.compressedSize) << " " << compressedSizeVariableName(fileData) << " = " << std::dec << fileData.compressedSize << ";" << std::endl;
+        writeDataArray(inStream, outStream, fileData.dataVariableName, fileData.compressedSize, options);
+        return;
+    }
+    if (chunks == 1)
+    {
+        writeDataArray(inStream, outStream, fileData.dataVariableName, fileData.size, options);
+        return;
+    }
+    inStream.seekg(static_cast<std::streamoff>(chunkIndex * options.shardSize));
+    writeDataArray(inStream, outStream, chunkVariableName(fileData, chunkIndex), chunkSize(fileData, chunkIndex, options.shardSize), options);
+    if (chunkIndex == 0)
+    {
+        // the segment table references the arrays of all chunks. they're declared in the common header
+        outStream << "const Res2hSegment " << segmentsVariableName(fileData) << "[" << std::dec << chunks << "] = {" << std::endl;
+        for (uint64_t index = 0; index < chunks; ++index)
+        {
+            outStream << indent << "{" << chunkVariableName(fileData, index) << ", " << chunkSize(fileData, index, options.shardSize) << "}" << (index + 1 < chunks ? "," : "") << std::endl;
+        }
+        outStream << "};" << std::endl
+                  << std::endl;
+    }
+}
+
+bool compressFile(std::istream &inStream, FileData &fileData, std::istringstream &compressedStream, std::ostream &errorStream)
+{
+    std::vector<uint8_t> data(static_cast<std::size_t>(fileData.size));
+    inStream.read(reinterpret_cast<char *>(data.data()), static_cast<std::streamsize>(data.size()));
+    if (static_cast<uint64_t>(inStream.gcount()) != fileData.size)
+    {
+        errorStream << "Failed to read file \"" << fileData.inPath.string() << "\"" << std::endl;
+        return false;
+    }
+    const auto compressed = compressLZ4(data.data(), data.size());
+    fileData.compressedSize = compressed.size();
+    compressedStream.str(std::string(compressed.cbegin(), compressed.cend()));
+    return true;
+}
+
+std::istream &openInputStream(const FileData &fileData, std::ifstream &fileStream, std::istringstream &dataStream)
+{
+    if (fileData.inPath == stdinPath)
+    {
+        return std::cin;
+    }
+    if (fileData.transformedData)
+    {
+        dataStream.str(*fileData.transformedData);
+        return dataStream;
+    }
+    fileStream.open(fileData.inPath.string(), std::ios_base::in | std::ios_base::binary);
+    return fileStream;
+}
+
+bool convertFile(FileData &fileData, const stdfs::path &commonHeaderPath, const ConvertOptions &options, std::ofstream &outStream, bool addHeader, std::ostream &infoStream, std::ostream &errorStream)
+{
+    const bool beVerbose = options.beVerbose;
+    if (fileData.inPath != stdinPath && !stdfs::exists(fileData.inPath))
+    {
+        errorStream << "File \"" << fileData.inPath.string() << "\" does not exist" << std::endl;
+        return false;
+    }
+    // try to open the input file
+    std::ifstream fileStream;
+    std::istringstream dataStream;
+    auto &inStream = openInputStream(fileData, fileStream, dataStream);
+    if (!inStream.good())
+    {
+        errorStream << "Failed to open file \"" << fileData.inPath.string() << "\" for reading" << std::endl;
+        return false;
+    }
+    IF_BEVERBOSE(infoStream << "Converting input file " << fileData.inPath)
+    // try getting size of data. streams can't seek, their size is known after converting
+    if (!fileData.isStream)
+    {
+        inStream.seekg(0, std::ios::end);
+        fileData.size = static_cast<uint64_t>(inStream.tellg());
+        inStream.seekg(0);
+    }
+    // check if the caller passed an output stream and use that
+    bool closeOutStream = false;
+    if (!outStream.is_open() || !outStream.good())
+    {
+        if (!fileData.outPath.empty())
+        {
+            // try opening a temporary output stream. truncate it when it exists
+            outStream.open(temporaryPath(fileData.outPath).string(), std::ofstream::out | std::ofstream::trunc | (options.outputMode == OutputMode::Elf ? std::ofstream::binary : std::ofstream::out));
+        }
+        else
+        {
+            errorStream << "No output stream passed, but output path for \"" << fileData.inPath.filename().string() << "\" is empty! Skipping." << std::endl;
+            return false;
+        }
+        closeOutStream = true;
+    }
+    if (!outStream.is_open() || !outStream.good())
+    {
+        errorStream << "Failed to open file \"" << fileData.outPath.string() << "\" for writing" << std::endl;
+        return false;
+    }
+    createVariableNames(fileData);
+    if (options.outputMode == OutputMode::Elf)
+    {
+        // write object file directly. the size variable has the same type as declared in the common header
+        try
+        {
+            writeElfObject(outStream, inStream, fileData.size, sizeTypeBytes(fileData.size), fileData.dataVariableName, fileData.sizeVariableName, std::max(options.dataAlignment, static_cast<uint64_t>(1)), dataSectionName(fileData.dataVariableName, options.useSections), hostElfTarget());
+        }
+        catch (const std::runtime_error &e)
+        {
+            errorStream << "Failed to write object file \"" << fileData.outPath.string() << "\": " << e.what() << std::endl;
+            return false;
+        }
+    }
+    else if (options.outputMode == OutputMode::Asm)
+    {
+        writeAsmData(outStream, fileData, options);
+    }
+    else
+    {
+        // check if caller wants to add a header
+        if (addHeader)
+        {
+            writeSourceHeader(outStream, fileData, fileData.outPath, commonHeaderPath, options);
+        }
+        if (options.compressData)
+        {
+            // write the compressed data instead. compressed files are never split
+            std::istringstream compressedStream;
+            if (!compressFile(inStream, fileData, compressedStream, errorStream))
+            {
+                return false;
+            }
+            writeChunk(compressedStream, outStream, fileData, 0, options);
+        }
+        else if (fileData.isStream)
+        {
+            // data is converted while reading it, so the size variable is defined behind the data array
+            fileData.size = writeDataArray(inStream, outStream, fileData.dataVariableName, unknownSize, options);
+            outStream << "const " << sizeTypeName(fileData.size) << " " << fileData.sizeVariableName << " = " << std::dec << fileData.size << ";" << std::endl;
+        }
+        else
+        {
+            writeChunk(inStream, outStream, fileData, 0, options);
+        }
+        if (options.registerEntries)
+        {
+            writeRegistryEntry(outStream, fileData);
+        }
+        // files bigger than the shard size are split. write the remaining chunks to their own files
+        for (uint64_t chunkIndex = 1; chunkIndex < nrOfChunks(fileData, options.shardSize); ++chunkIndex)
+        {
+            if (!closeOutStream)
+            {
+                writeChunk(inStream, outStream, fileData, chunkIndex, options);
+                continue;
+            }
+            const auto chunkPath = chunkOutputPath(fileData, chunkIndex);
+            std::ofstream chunkStream(temporaryPath(chunkPath).string(), std::ofstream::out | std::ofstream::trunc);
+            if (!chunkStream.is_open() || !chunkStream.good())
+            {
+                errorStream << "Failed to open file \"" << chunkPath.string() << "\" for writing" << std::endl;
+                return false;
+            }
+            writeSourceHeader(chunkStream, fileData, chunkPath, commonHeaderPath, options);
+            writeChunk(inStream, chunkStream, fileData, chunkIndex, options);
+            if (!finishOutputFile(chunkStream, chunkPath, beVerbose, infoStream, errorStream))
+            {
+                return false;
+            }
+        }
+    }
+    // close files. only replace the output file if something changed
+    fileStream.close();
+    if (closeOutStream && !finishOutputFile(outStream, fileData.outPath, beVerbose, infoStream, errorStream))
+    {
+        return false;
+    }
+    IF_BEVERBOSE(infoStream << " - succeeded." << std::endl)
+    return true;
+}
+
+/// @brief Append the sizeof(VALUE) bytes of value to data in host byte order, like archives store them.
+template <typename VALUE>
+static void appendValue(std::string &data, VALUE value)
+{
+    data.append(reinterpret_cast<const char *>(&value), sizeof(VALUE));
+}
+
+/// @brief Layout of the archive data and the sizes and checksums filled in by the copy functions.
+template <typename T>
+struct ArchiveData
+{
+    std::vector<uint64_t> fileOffsets; // !<Offsets of the file data in the archive, including padding for the data alignment.
+    std::vector<uint64_t> fileSizes;
+    std::vector<T> fileChecksums;
+    FletcherStream<T> archiveChecksum;
+    uint64_t bytesCopied = 0; // !<Number of data bytes copied, without padding.
+    uint64_t dataEnd = 0; // !<Offset after the data of the last file. The archive checksum is stored here.
+};
+
+/// @brief Write zero bytes to outStream up to archiveOffset. position is the current offset of outStream and is set to archiveOffset.
+static void writePadding(std::ofstream &outStream, uint64_t &position, uint64_t archiveOffset)
+{
+    static const std::array<char, 4096> zeros{};
+    const uint64_t paddingSize = archiveOffset - position;
+    for (uint64_t written = 0; written < paddingSize; written += zeros.size())
+    {
+        outStream.write(zeros.data(), static_cast<std::streamsize>(std::min(static_cast<uint64_t>(zeros.size()), paddingSize - written)));
+    }
+    position = archiveOffset;
+}
+
+/// @brief Return true if the data of file is copied to archives with copyFileRange() by copyArchiveDataSequential(). The data is still read for checksumming,
+/// but on reflink-capable filesystems the copy may only share data blocks. Small files are cheaper to write from the buffer.
+static bool useKernelCopy(const FileData &file)
+{
+    return !file.isStream && !file.transformedData && file.size >= kernelCopyMinSize;
+}
+
+/// @brief Copy size bytes at offset in file to archiveOffset in the archive filePath, which is written by outStream, in the kernel.
+/// outStream is positioned after the bytes copied. Returns the number of bytes copied. The caller must write the rest.
+static uint64_t kernelCopy(const FileData &file, uint64_t offset, uint64_t size, std::ofstream &outStream, const stdfs::path &filePath, uint64_t archiveOffset)
+{
+    // data written to outStream before must be in the file, else it could overwrite the copy later
+    outStream.flush();
+    const uint64_t copied = copyFileRange(filePath, archiveOffset, file.inPath, offset, size);
+    outStream.seekp(static_cast<std::streamoff>(archiveOffset + copied));
+    return copied;
+}
+
+/// @brief Append the data of all files to outStream, reading them one after another on the calling thread.
+/// This is the only way to copy streams, because their size is unknown until they have been read.
+template <typename T>
+static bool copyArchiveDataSequential(const std::vector<FileData> &fileList, std::ofstream &outStream, const stdfs::path &filePath, ArchiveData<T> &archiveData, uint64_t dataStart, bool beVerbose, Stats &statistics)
+{
+    std::vector<char> buffer(archiveCopyBufferSize);
+    uint64_t position = dataStart;
+    for (std::size_t index = 0; index < fileList.size(); ++index)
+    {
+        const auto &file = fileList[index];
+        const auto fileStart = std::chrono::steady_clock::now();
+        std::ifstream fileStream;
+        std::istringstream dataStream;
+        auto &inStream = openInputStream(file, fileStream, dataStream);
+        if (!inStream.good())
+        {
+            std::cerr << "Failed to open file \"" << file.inPath.string() << "\" for reading" << std::endl;
+            return false;
+        }
+        IF_BEVERBOSE(std::cout << "Adding data for \"" << file.internalName << "\"" << std::endl)
+        // zero padding only moves the following data in the archive checksum, which adding an empty stream at the new position does
+        writePadding(outStream, position, archiveData.fileOffsets[index]);
+        archiveData.archiveChecksum.add(FletcherStream<T>(position));
+        const uint64_t kernelCopied = useKernelCopy(file) ? kernelCopy(file, 0, file.size, outStream, filePath, position) : 0;
+        FletcherStream<T> fileChecksum;
+        while (inStream.good())
+        {
+            inStream.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+            const auto readSize = static_cast<uint64_t>(inStream.gcount());
+            // bytes copied in the kernel are only checksummed
+            const uint64_t skipSize = std::min(readSize, kernelCopied - std::min(kernelCopied, archiveData.fileSizes[index]));
+            outStream.write(buffer.data() + skipSize, static_cast<std::streamsize>(readSize - skipSize));
+            fileChecksum.update(reinterpret_cast<const uint8_t *>(buffer.data()), readSize);
+            archiveData.archiveChecksum.update(reinterpret_cast<const uint8_t *>(buffer.data()), readSize);
+            archiveData.fileSizes[index] += readSize;
+        }
+        // streams can only be read once, so their size is only known now. a stream is always the only input file,
+        // so no data offsets depend on its size
+        if (inStream.bad() || (!file.isStream && archiveData.fileSizes[index] != file.size))
+        {
+            std::cerr << "Failed to completely copy file \"" << file.inPath.string() << "\" to binary data" << std::endl;
+            return false;
+        }
+        archiveData.fileChecksums[index] = fileChecksum.checksum();
+        archiveData.bytesCopied += archiveData.fileSizes[index];
+        position += archiveData.fileSizes[index];
+        statistics.files.push_back({file.inPath.string(), secondsSince(fileStart), archiveData.fileSizes[index]});
+    }
+    archiveData.dataEnd = position;
+    return true;
+}
+
+/// @brief Part of a file that is read and checksummed by one reader thread.
+struct ArchiveBlock
+{
+    std::size_t fileIndex = 0;
+    uint64_t offset = 0; // !<Offset of the block in the file.
+    uint64_t size = 0;
+    uint64_t archiveOffset = 0; // !<Offset of the block in the archive.
+};
+
+/// @brief Buffer holding a block that has been read, but not written yet.
+template <typename T>
+struct ArchiveBlockBuffer
+{
+    std::vector<char> data;
+    FletcherStream<T> fileChecksum;
+    FletcherStream<T> archiveChecksum;
+    double seconds = 0; // !<Time spent reading and checksumming the block.
+    std::string error; // !<Error message if reading failed.
+    bool isReady = false; // !<True if the block has been read and can be written.
+};
+
+/// @brief Read block into buffer and checksum it. Errors are stored in buffer.error.
+template <typename T>
+static void readArchiveBlock(const FileData &file, const ArchiveBlock &block, ArchiveBlockBuffer<T> &buffer)
+{
+    const auto start = std::chrono::steady_clock::now();
+    buffer.data.resize(static_cast<std::size_t>(block.size));
+    buffer.error.clear();
+    if (file.transformedData)
+    {
+        std::memcpy(buffer.data.data(), file.transformedData->data() + block.offset, static_cast<std::size_t>(block.size));
+    }
+    else
+    {
+        std::ifstream inStream(file.inPath.string(), std::ios_base::in | std::ios_base::binary);
+        if (!inStream.is_open())
+        {
+            buffer.error = "Failed to open file \"" + file.inPath.string() + "\" for reading";
+            return;
+        }
+        inStream.seekg(static_cast<std::streamoff>(block.offset));
+        inStream.read(buffer.data.data(), static_cast<std::streamsize>(block.size));
+        // files may not change while the archive is written. a shorter file would shift all following data
+        if (static_cast<uint64_t>(inStream.gcount()) != block.size)
+        {
+            buffer.error = "Failed to completely copy file \"" + file.inPath.string() + "\" to binary data";
+            return;
+        }
+    }
+    buffer.fileChecksum = FletcherStream<T>(block.offset);
+    buffer.fileChecksum.update(reinterpret_cast<const uint8_t *>(buffer.data.data()), block.size);
+    buffer.archiveChecksum = FletcherStream<T>(block.archiveOffset);
+    buffer.archiveChecksum.update(reinterpret_cast<const uint8_t *>(buffer.data.data()), block.size);
+    buffer.seconds = secondsSince(start);
+}
+
+/// @brief Append the data of all files to outStream. threadCount reader threads read and checksum blocks of at most archiveBlockSize bytes
+/// ahead into a bounded number of buffers, while the calling thread writes the blocks in order, so the archive does not depend on threadCount.
+/// Big files are split into blocks, so a few huge files among many small ones still keep all readers busy.
+/// Blocks are always written from the buffer they were read into. Copying them in the kernel too would copy the data twice.
+template <typename T>
+static bool copyArchiveDataPipelined(const std::vector<FileData> &fileList, std::ofstream &outStream, ArchiveData<T> &archiveData, uint64_t dataStart, uint32_t threadCount, bool beVerbose, Stats &statistics)
+{
+    std::vector<ArchiveBlock> blocks;
+    for (std::size_t index = 0; index < fileList.size(); ++index)
+    {
+        for (uint64_t offset = 0; offset < fileList[index].size; offset += archiveBlockSize)
+        {
+            const uint64_t size = std::min(archiveBlockSize, fileList[index].size - offset);
+            blocks.push_back({index, offset, size, archiveData.fileOffsets[index] + offset});
+        }
+    }
+    // readers may be at most nrOfBuffers blocks ahead of the writer, which limits memory use to nrOfBuffers * archiveBlockSize
+    const std::size_t nrOfBuffers = std::max(static_cast<std::size_t>(2), static_cast<std::size_t>(threadCount) * 2);
+    std::vector<ArchiveBlockBuffer<T>> buffers(nrOfBuffers);
+    std::mutex mutex;
+    std::condition_variable blockRead;
+    std::condition_variable blockWritten;
+    std::size_t nextBlock = 0;
+    std::size_t writtenBlocks = 0;
+    bool aborted = false;
+    auto reader = [&]() {
+        while (true)
+        {
+            std::size_t blockIndex = 0;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                if (aborted || nextBlock >= blocks.size())
+                {
+                    return;
+                }
+                blockIndex = nextBlock++;
+                blockWritten.wait(lock, [&]() { return aborted || blockIndex < writtenBlocks + nrOfBuffers; });
+                if (aborted)
+                {
+                    return;
+                }
+            }
+            // the buffer is only used by this thread until it is marked ready
+            auto &buffer = buffers[blockIndex % nrOfBuffers];
+            readArchiveBlock(fileList[blocks[blockIndex].fileIndex], blocks[blockIndex], buffer);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                buffer.isReady = true;
+            }
+            blockRead.notify_one();
+        }
+    };
+    std::vector<std::thread> threads;
+    for (uint32_t i = 0; i < std::min(static_cast<std::size_t>(threadCount), blocks.size()); ++i)
+    {
+        threads.emplace_back(reader);
+    }
+    auto stopReaders = [&]() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            aborted = true;
+        }
+        blockWritten.notify_all();
+        for (auto &thread : threads)
+        {
+            thread.join();
+        }
+    };
+    std::vector<FletcherStream<T>> fileChecksums(fileList.size());
+    std::vector<double> fileSeconds(fileList.size(), 0);
+    uint64_t position = dataStart;
+    for (std::size_t blockIndex = 0; blockIndex < blocks.size(); ++blockIndex)
+    {
+        const auto &block = blocks[blockIndex];
+        auto &buffer = buffers[blockIndex % nrOfBuffers];
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            blockRead.wait(lock, [&]() { return buffer.isReady; });
+        }
+        if (!buffer.error.empty())
+        {
+            stopReaders();
+            std::cerr << buffer.error << std::endl;
+            return false;
+        }
+        if (block.offset == 0)
+        {
+            IF_BEVERBOSE(std::cout << "Adding data for \"" << fileList[block.fileIndex].internalName << "\"" << std::endl)
+        }
+        const auto writeStart = std::chrono::steady_clock::now();
+        // block checksums know their position in the archive, so zero padding doesn't need to be checksummed
+        writePadding(outStream, position, block.archiveOffset);
+        outStream.write(buffer.data.data(), static_cast<std::streamsize>(block.size));
+        position += block.size;
+        fileChecksums[block.fileIndex].add(buffer.fileChecksum);
+        archiveData.archiveChecksum.add(buffer.archiveChecksum);
+        fileSeconds[block.fileIndex] += buffer.seconds + secondsSince(writeStart);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            buffer.isReady = false;
+            ++writtenBlocks;
+        }
+        blockWritten.notify_all();
+    }
+    stopReaders();
+    for (std::size_t index = 0; index < fileList.size(); ++index)
+    {
+        archiveData.fileSizes[index] = fileList[index].size;
+        archiveData.fileChecksums[index] = fileChecksums[index].checksum();
+        archiveData.bytesCopied += fileList[index].size;
+        statistics.files.push_back({fileList[index].inPath.string(), fileSeconds[index], fileList[index].size});
+    }
+    archiveData.dataEnd = position;
+    return true;
+}
+
+/// @brief Write the binary archive for createBlob() using T (uint32_t or uint64_t) for sizes, offsets and checksums.
+/// The header and directory hold the sizes and checksums of the data, so they're written last. Space for them is reserved first.
+/// Every input file is read only once and the checksums of the files and the whole archive are calculated while copying.
+/// When written sequentially, big files are additionally copied in the kernel with one call per file, so their data doesn't pass through the buffer twice.
+template <typename T>
+static bool writeArchive(const std::vector<FileData> &fileList, const stdfs::path &filePath, uint64_t directorySize, uint64_t dataAlignment, uint32_t threadCount, bool beVerbose, Stats &statistics)
+{
+    // try opening the output file. truncate it when it exists
+    std::ofstream outStream(filePath.string(), std::ofstream::out | std::ofstream::binary | std::ofstream::trunc);
+    if (!outStream.is_open() || !outStream.good())
+    {
+        std::cerr << "Failed to open file \"" << filePath.string() << "\" for writing" << std::endl;
+        return false;
+    }
+    const uint64_t headerSize = (sizeof(T) == sizeof(uint64_t) ? RES2H_HEADER_SIZE_64 : RES2H_HEADER_SIZE_32) + directorySize;
+    const std::string placeholder(static_cast<std::size_t>(headerSize), '\0');
+    outStream.write(placeholder.data(), static_cast<std::streamsize>(placeholder.size()));
+    // copy data for all files. the header bytes are added to the archive checksum when they're known
+    ArchiveData<T> archiveData;
+    archiveData.fileSizes.resize(fileList.size(), 0);
+    archiveData.fileChecksums.resize(fileList.size(), 0);
+    archiveData.archiveChecksum = FletcherStream<T>(headerSize);
+    // the data of every file starts at a multiple of dataAlignment. empty files have no data and are not aligned,
+    // so no offset points past the data. a stream is always the only input file, so its unknown size moves no offsets
+    uint64_t dataEnd = headerSize;
+    for (const auto &file : fileList)
+    {
+        if (file.size > 0 || file.isStream)
+        {
+            dataEnd = (dataEnd + dataAlignment - 1) / dataAlignment * dataAlignment;
+        }
+        archiveData.fileOffsets.push_back(dataEnd);
+        dataEnd += file.size;
+    }
+    const bool hasStreams = std::any_of(fileList.cbegin(), fileList.cend(), [](const FileData &file) { return file.isStream; });
+    if (!hasStreams)
+    {
+        // the final size is header + data + checksum
+        outStream.flush();
+        preallocateFile(filePath, dataEnd + sizeof(T));
+    }
+    const auto phaseStart = std::chrono::steady_clock::now();
+    const bool copied = (threadCount > 1 && !hasStreams) ? copyArchiveDataPipelined(fileList, outStream, archiveData, headerSize, threadCount, beVerbose, statistics)
+                                                         : copyArchiveDataSequential(fileList, outStream, filePath, archiveData, headerSize, beVerbose, statistics);
+    if (!copied)
+    {
+        return false;
+    }
+    const auto &fileSizes = archiveData.fileSizes;
+    const auto &fileChecksums = archiveData.fileChecksums;
+    auto &archiveChecksum = archiveData.archiveChecksum;
+    statistics.phases.push_back({"archive data", secondsSince(phaseStart), archiveData.bytesCopied});
+    // final archive size is header + data + checksum
+    const uint64_t archiveSize = archiveData.dataEnd + sizeof(T);
+    std::string header;
+    header.reserve(static_cast<std::size_t>(headerSize));
+    header.append(RES2H_MAGIC_BYTES, sizeof(RES2H_MAGIC_BYTES) - 1);
+    appendValue(header, static_cast<uint32_t>(RES2H_ARCHIVE_VERSION));
+    uint32_t alignmentShift = 0;
+    while ((static_cast<uint64_t>(1) << alignmentShift) < dataAlignment)
+    {
+        ++alignmentShift;
+    }
+    appendValue(header, static_cast<uint32_t>(sizeof(T) * 8) | (alignmentShift << RES2H_FORMAT_ALIGNMENT_SHIFT));
+    appendValue(header, static_cast<T>(archiveSize));
+    appendValue(header, static_cast<uint32_t>(fileList.size()));
+    // add directory entries with name, flags, data size, offset from file start to start of data and checksum
+    for (std::size_t index = 0; index < fileList.size(); ++index)
+    {
+        const auto &file = fileList[index];
+        appendValue(header, static_cast<uint16_t>(file.internalName.size()));
+        header.append(file.internalName);
+        appendValue(header, static_cast<uint32_t>(0));
+        appendValue(header, static_cast<T>(fileSizes[index]));
+        appendValue(header, static_cast<T>(archiveData.fileOffsets[index]));
+        appendValue(header, fileChecksums[index]);
+        IF_BEVERBOSE(std::cout << "Created directory entry for \"" << file.internalName << "\"" << std::endl)
+        IF_BEVERBOSE(std::cout << "Data starts at " << std::dec << std::showbase << archiveData.fileOffsets[index] << " bytes" << std::endl)
+        IF_BEVERBOSE(std::cout << "Size is " << std::dec << fileSizes[index] << " bytes" << std::endl)
+        IF_BEVERBOSE(std::cout << "Fletcher" << sizeof(T) * 8 << " checksum is " << std::hex << std::showbase << fileChecksums[index] << std::endl)
+    }
+    outStream.seekp(0);
+    outStream.write(header.data(), static_cast<std::streamsize>(header.size()));
+    archiveChecksum.addPrefix(reinterpret_cast<const uint8_t *>(header.data()), header.size());
+    const T checksum = archiveChecksum.checksum();
+    outStream.seekp(static_cast<std::streamoff>(archiveData.dataEnd));
+    outStream.write(reinterpret_cast<const char *>(&checksum), sizeof(T));
+    outStream.close();
+    if (outStream.fail())
+    {
+        std::cerr << "Failed to write file \"" << filePath.string() << "\"" << std::endl;
+        return false;
+    }
+    IF_BEVERBOSE(std::cout << "Binary archive creation succeeded." << std::endl)
+    IF_BEVERBOSE(std::cout << "Archive has " << std::dec << archiveSize << " bytes." << std::endl)
+    IF_BEVERBOSE(std::cout << "Archive Fletcher" << sizeof(T) * 8 << " checksum is " << std::hex << std::showbase << checksum << "." << std::endl)
+    return true;
+}
+
+bool createBlob(const std::vector<FileData> &fileList, const stdfs::path &filePath, uint64_t dataAlignment, uint32_t threadCount, bool beVerbose, Stats &statistics)
+{
+    dataAlignment = std::max(dataAlignment, static_cast<uint64_t>(1));
+    // check if a 64bit archive is needed, or 32bits suffice
+    const auto nrOfEntries = static_cast<uint64_t>(fileList.size());
+    uint64_t directorySize = 0;
+    uint64_t maxDataSize = 0;
+    uint64_t dataSize = 0;
+    for (const auto &file : fileList)
+    {
+        if (file.internalName.size() > UINT16_MAX)
+        {
+            std::cerr << "File name \"" << file.internalName << "\" is too long" << std::endl;
+            return false;
+        }
+        dataSize += file.size;
+        maxDataSize = maxDataSize < file.size ? file.size : maxDataSize;
+        directorySize += file.internalName.size();
+    }
+    // the size of streams is unknown, so they always need 64 bit.
+    // else take worst case header, fixed directory size and padding for the data alignment into account and check if we need 32 or 64 bit
+    const bool hasStreams = std::any_of(fileList.cbegin(), fileList.cend(), [](const FileData &file) { return file.isStream; });
+    const uint64_t paddingSize = nrOfEntries * (dataAlignment - 1);
+    const bool mustUse64Bit = hasStreams || maxDataSize > UINT32_MAX || (RES2H_HEADER_SIZE_64 + directorySize + nrOfEntries * RES2H_DIRECTORY_SIZE_64 + paddingSize + dataSize + sizeof(uint64_t)) > UINT32_MAX;
+    IF_BEVERBOSE(std::cout << std::endl
+                           << "Creating binary " << (mustUse64Bit ? "64" : "32") << "bit archive " << filePath << std::endl)
+    // now that we know how many bits, add the fixed size of the directory entries
+    directorySize += nrOfEntries * (mustUse64Bit ? RES2H_DIRECTORY_SIZE_64 : RES2H_DIRECTORY_SIZE_32);
+    return mustUse64Bit ? writeArchive<uint64_t>(fileList, filePath, directorySize, dataAlignment, threadCount, beVerbose, statistics)
+                        : writeArchive<uint32_t>(fileList, filePath, directorySize, dataAlignment, threadCount, beVerbose, statistics);
+}
@@ -0,0 +1,108 @@
+// Conversion of files to source, object or assembler files and to binary archives
+#pragma once
+
+#include "res2hhelpers.h"
+#include "res2hstats.h"
+#include "stdfs.h"
+
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/// @brief How data is written to the generated .c/.cpp files.
+enum class OutputMode
+{
+    Hex, // comma-separated hex values in an array initializer list
+    String, // escaped string literals
+    Elf, // relocatable ELF object files
+    Asm // assembler files including the data using .incbin
+};
+
+/// @brief Options that influence the content of converted files. The defaults are the defaults of the res2h command line.
+struct ConvertOptions
+{
+    OutputMode outputMode = OutputMode::Hex;
+    bool useC = false; // !<Write C instead of C++ code.
+    bool useSections = false; // !<Put every data array into its own linker section.
+    bool compressData = false; // !<Store data LZ4-compressed. It is decompressed by the utilities on first use.
+    bool registerEntries = false; // !<Put an entry for every file into the "res2h_entries" linker section.
+    uint64_t shardSize = 0; // !<Maximum number of data bytes per output file. 0 means no limit.
+    uint64_t dataAlignment = 0; // !<Alignment of data arrays in bytes. 0 means the default alignment of the compiler.
+    bool beVerbose = false; // !<Output diagnostic information to the info stream.
+};
+
+/// @brief Input path meaning the data is read from stdin.
+extern const stdfs::path stdinPath;
+
+/// @brief Indentation of one level in generated code.
+extern const std::string indent;
+
+/// @brief Macro to do / print something if verbose output is on. Needs a bool beVerbose in scope. Yes, this should probably be a template...
+#define IF_BEVERBOSE(a)         \
+    {                           \
+        if (beVerbose) { (a); } \
+    }
+
+/// @brief Create names for the size and data variables of a file from its output path.
+void createVariableNames(FileData &fileData);
+
+/// @brief Return the path generated files are written to before they're moved to outPath.
+stdfs::path temporaryPath(const stdfs::path &outPath);
+
+/// @brief Close outStream writing to the temporary path of outPath and move the temporary file to outPath if its content differs.
+/// Unchanged files keep their modification time, so build systems don't need to compile them again.
+bool finishOutputFile(std::ofstream &outStream, const stdfs::path &outPath, bool beVerbose = false, std::ostream &infoStream = std::cout, std::ostream &errorStream = std::cerr);
+
+/// @brief Return the name of the C type used to store a size value.
+std::string sizeTypeName(uint64_t size);
+
+/// @brief Return the number of chunks the data of a file is split into. Only files bigger than shardSize are split.
+uint64_t nrOfChunks(const FileData &fileData, uint64_t shardSize);
+
+/// @brief Return the number of bytes in chunk chunkIndex of a file.
+uint64_t chunkSize(const FileData &fileData, uint64_t chunkIndex, uint64_t shardSize);
+
+/// @brief Return the name of the array holding chunk chunkIndex of a file that is split.
+std::string chunkVariableName(const FileData &fileData, uint64_t chunkIndex);
+
+/// @brief Return the name of the variable holding the size of the compressed data of a file.
+std::string compressedSizeVariableName(const FileData &fileData);
+
+/// @brief Return the name of the segment table of a file that is split.
+std::string segmentsVariableName(const FileData &fileData);
+
+/// @brief Return the path of the file chunk chunkIndex of a file is written to. The first chunk goes to the regular output file.
+stdfs::path chunkOutputPath(const FileData &fileData, uint64_t chunkIndex);
+
+/// @brief Write a section attribute for the following definition if options.useSections is set.
+void writeSectionAttribute(std::ostream &outStream, const std::string &sectionName, const ConvertOptions &options);
+
+/// @brief Write the variable definitions for chunk chunkIndex of a file. If the file is not split, this is the size and data variable.
+/// If it is split, the chunk is stored in its own array and the first chunk also defines the size variable and the segment table.
+void writeChunk(std::istream &inStream, std::ostream &outStream, const FileData &fileData, uint64_t chunkIndex, const ConvertOptions &options);
+
+/// @brief Read the whole content of inStream, compress it and store the compressed data in compressedStream and its size in fileData.
+bool compressFile(std::istream &inStream, FileData &fileData, std::istringstream &compressedStream, std::ostream &errorStream);
+
+/// @brief Return the stream the data of fileData is read from. This is std::cin for stdinPath, dataStream reading the
+/// transformed data if transforms were applied, else fileStream opened for inPath.
+/// Check good() on the result to see if opening the file succeeded.
+std::istream &openInputStream(const FileData &fileData, std::ifstream &fileStream, std::istringstream &dataStream);
+
+/// @brief Convert a file to a .c/.cpp, object or assembler file and fill in the variable names and sizes of fileData.
+/// @param commonHeaderPath Common header generated files include. Pass an empty path to not include a header.
+/// @param outStream If open, the data is appended to this stream, else it is written to fileData.outPath.
+/// @param addHeader Write the file comment and header include before the data.
+/// @return Returns true if the file was converted. Errors are written to errorStream.
+bool convertFile(FileData &fileData, const stdfs::path &commonHeaderPath, const ConvertOptions &options, std::ofstream &outStream, bool addHeader = true, std::ostream &infoStream = std::cout, std::ostream &errorStream = std::cerr);
+
+/// @brief Write all files in fileList to the binary archive filePath.
+/// The archive uses 64 bit sizes and offsets if needed, else 32 bit. See README.md for the format.
+/// @param dataAlignment Alignment of the data of every file relative to the archive start in bytes. Must be a power of two. 0 means no alignment.
+/// @param threadCount Number of threads reading and checksumming input files ahead of writing them. The archive is the same for any number of threads.
+/// @param statistics Time spent on checksums and data is added to its phases and files.
+/// @return Returns true if the archive was written. Errors are written to std::cerr.
+bool createBlob(const std::vector<FileData> &fileList, const stdfs::path &filePath, uint64_t dataAlignment, uint32_t threadCount, bool beVerbose, Stats &statistics);
@@ -100,6 +100,7 @@ static bool dumpArchive(const stdfs::path &destination, const stdfs::path &archi
             std::cout << "File version: " << std::dec << archiveInfo.fileVersion << std::endl;
             std::cout << "File format: " << std::hex << std::showbase << archiveInfo.formatFlags << std::endl;
             std::cout << "Bits: " << std::dec << static_cast<uint32_t>(archiveInfo.bits) << std::endl;
+            std::cout << "Data alignment: " << std::dec << archiveInfo.dataAlignment << " bytes" << std::endl;
             std::cout << "Checksum: " << std::hex << std::showbase << archiveInfo.checksum << std::endl;
             std::cout << "------------------------------------------------------------------------" << std::endl;
             // dump resource information
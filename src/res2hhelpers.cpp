@@ -1,110 +1,190 @@
 #include "res2hhelpers.h"
 
+#include "checksum.h"
 #include "stdfshelpers.h"
 
 #include <algorithm>
+#include <condition_variable>
+#include <fstream>
 #include <iostream>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <utility>
 
-std::vector<FileData> getFileData(const stdfs::path &inPath, const stdfs::path &parentDir, bool recurse, bool beVerbose)
+#if !defined(_WIN32)
+#include <sys/stat.h>
+
+#include <cerrno>
+#endif
+
+/// @brief Directories still to scan and the files found by getFileData(). Shared by all threads.
+struct ScanState
 {
-    // get all files from directory
+    std::mutex mutex;
+    std::condition_variable directoryAdded;
+    std::vector<stdfs::path> directories; // !<Directories waiting to be scanned.
+    uint64_t pendingDirectories = 0; // !<Directories waiting or being scanned. Scanning is done when this is 0.
     std::vector<FileData> files;
-    // check for infinite symlinks
-    if (hasRecursiveSymlink(inPath))
+    std::vector<stdfs::path> visitedDirectories;
+};
+
+/// @brief Return the type of filePath and for regular files their size in size, following symlinks.
+/// On POSIX systems this is a single stat() call instead of status() plus file_size().
+static stdfs::file_type entryType(const stdfs::path &filePath, uint64_t &size, std::error_code &error)
+{
+#if !defined(_WIN32)
+    struct stat fileStat = {};
+    if (stat(filePath.c_str(), &fileStat) != 0)
     {
-        std::cerr << "Warning: Path " << inPath << " contains recursive symlink! Skipping." << std::endl;
-        return files;
+        error = std::error_code(errno, std::generic_category());
+        return stdfs::file_type::none;
     }
-    // iterate through source directory searching for files
+    error.clear();
+    size = static_cast<uint64_t>(fileStat.st_size);
+    return S_ISREG(fileStat.st_mode) ? stdfs::file_type::regular : (S_ISDIR(fileStat.st_mode) ? stdfs::file_type::directory : stdfs::file_type::unknown);
+#else
+    const auto type = stdfs::status(filePath, error).type();
+    if (!error && type == stdfs::file_type::regular)
+    {
+        size = static_cast<uint64_t>(stdfs::file_size(filePath, error));
+    }
+    return type;
+#endif
+}
+
+/// @brief Scan a single directory and add the files found to files and subdirectories found to subDirectories.
+/// Every entry is only checked once, see entryType(). Messages are written to errors.
+static void scanDirectory(const stdfs::path &dirPath, const stdfs::path &parentDir, bool recurse, std::vector<FileData> &files, std::vector<stdfs::path> &subDirectories, std::ostream &errors)
+{
+    std::error_code error;
     const stdfs::directory_iterator dirEnd;
-    for (stdfs::directory_iterator fileIt(inPath); fileIt != dirEnd; ++fileIt)
+    for (stdfs::directory_iterator fileIt(dirPath, error); !error && fileIt != dirEnd; fileIt.increment(error))
     {
-        stdfs::path filePath = (*fileIt).path();
-        if (stdfs::is_regular_file(filePath))
+        const auto &filePath = fileIt->path();
+        // this runs on scan threads, so errors must not throw
+        uint64_t size = 0;
+        std::error_code statusError;
+        const auto type = entryType(filePath, size, statusError);
+        if (statusError)
+        {
+            errors << "Failed to get status of " << filePath << ": " << statusError.message() << std::endl;
+            errors << "Skipping entry" << std::endl;
+            continue;
+        }
+        if (type == stdfs::file_type::regular)
         {
-            if (beVerbose)
-            {
-                std::cout << "Found input file " << filePath << std::endl;
-            }
             FileData temp;
             temp.inPath = filePath;
-            auto subPath = naiveRelative(filePath, parentDir);
             // add a ":/" before the name to mark internal resources (Yes. Hello Qt!)
-            temp.internalName = ":/" + subPath.generic_string();
-            // remove parent directory of file from path for internal name
-            if (beVerbose)
+            temp.internalName = ":/" + naiveRelative(filePath, parentDir).generic_string();
+            temp.size = size;
+            files.push_back(std::move(temp));
+        }
+        else if (recurse && type == stdfs::file_type::directory)
+        {
+            subDirectories.push_back(filePath);
+        }
+    }
+    if (error)
+    {
+        errors << "Failed to read directory " << dirPath << ": " << error.message() << std::endl;
+    }
+}
+
+std::vector<FileData> getFileData(const stdfs::path &inPath, const stdfs::path &parentDir, bool recurse, bool beVerbose, uint32_t nrOfThreads, std::vector<stdfs::path> *visitedDirectories)
+{
+    ScanState state;
+    state.directories.push_back(inPath);
+    state.pendingDirectories = 1;
+    // directories are handed out to all threads. every thread collects files in its own vector first
+    auto worker = [&]() {
+        std::unique_lock<std::mutex> lock(state.mutex);
+        while (true)
+        {
+            state.directoryAdded.wait(lock, [&]() { return !state.directories.empty() || state.pendingDirectories == 0; });
+            if (state.directories.empty())
+            {
+                return;
+            }
+            const stdfs::path dirPath = std::move(state.directories.back());
+            state.directories.pop_back();
+            lock.unlock();
+            std::vector<FileData> files;
+            std::vector<stdfs::path> subDirectories;
+            std::ostringstream errors;
+            // check for infinite symlinks
+            const bool isRecursive = hasRecursiveSymlink(dirPath);
+            if (isRecursive)
             {
-                std::cout << "File path: " << filePath << std::endl;
-                std::cout << "Parent dir: " << parentDir << std::endl;
-                std::cout << "Internal name will be \"" << temp.internalName << "\"" << std::endl;
+                errors << "Warning: Path " << dirPath << " contains recursive symlink! Skipping." << std::endl;
             }
-            try
+            else
             {
-                // get file size and add to file list
-                temp.size = static_cast<uint64_t>(stdfs::file_size(filePath));
-                if (beVerbose)
-                {
-                    std::cout << "Size is " << temp.size << " bytes." << std::endl;
-                }
-                files.push_back(temp);
+                scanDirectory(dirPath, parentDir, recurse, files, subDirectories, errors);
             }
-            catch (const stdfs::filesystem_error &e)
+            lock.lock();
+            std::cerr << errors.str();
+            if (!isRecursive)
             {
-                std::cerr << "Failed to get size of " << filePath << ": " << e.what() << std::endl;
-                std::cerr << "Skipping file" << std::endl;
+                state.visitedDirectories.push_back(dirPath);
             }
+            state.files.insert(state.files.end(), std::make_move_iterator(files.begin()), std::make_move_iterator(files.end()));
+            state.directories.insert(state.directories.end(), std::make_move_iterator(subDirectories.begin()), std::make_move_iterator(subDirectories.end()));
+            state.pendingDirectories += subDirectories.size();
+            --state.pendingDirectories;
+            state.directoryAdded.notify_all();
         }
+    };
+    std::vector<std::thread> threads;
+    for (uint32_t i = 1; i < nrOfThreads; ++i)
+    {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto &thread : threads)
+    {
+        thread.join();
     }
-    // does the user want subdirectories?
-    if (recurse)
+    // threads find files in random order. sort them, so the result is deterministic
+    naiveSortByInPath(state.files);
+    if (beVerbose)
     {
-        // iterate through source directory again searching for directories
-        for (stdfs::directory_iterator dirIt(inPath); dirIt != dirEnd; ++dirIt)
+        for (const auto &file : state.files)
         {
-            stdfs::path dirPath = (*dirIt).path();
-            if (stdfs::is_directory(dirPath))
-            {
-                if (beVerbose)
-                {
-                    std::cout << "Found subdirectory " << dirPath << std::endl;
-                }
-                // subdirectory found. recurse and add returned result to file list
-                std::vector<FileData> subFiles = getFileData(dirPath, parentDir, recurse, beVerbose);
-                files.insert(files.end(), subFiles.cbegin(), subFiles.cend());
-            }
+            std::cout << "Found input file " << file.inPath << std::endl;
+            std::cout << "Internal name will be \"" << file.internalName << "\"" << std::endl;
+            std::cout << "Size is " << file.size << " bytes." << std::endl;
         }
     }
-    // return result
-    return files;
+    if (visitedDirectories != nullptr)
+    {
+        std::sort(state.visitedDirectories.begin(), state.visitedDirectories.end());
+        *visitedDirectories = std::move(state.visitedDirectories);
+    }
+    return std::move(state.files);
 }
 
-std::vector<FileData> naiveSortByInPath(const std::vector<FileData> &files)
+void naiveSortByInPath(std::vector<FileData> &files)
 {
-    std::vector<FileData> result = files;
-    std::sort(result.begin(), result.end(), [](const auto &pa, const auto &pb) { return pa.inPath < pb.inPath; });
-    return result;
+    std::sort(files.begin(), files.end(), [](const auto &pa, const auto &pb) { return pa.inPath < pb.inPath; });
 }
 
-std::vector<FileData> generateOutputPaths(const std::vector<FileData> &files, const stdfs::path &parentDir, const stdfs::path &outPath, bool useC, bool beVerbose)
+void generateOutputPaths(std::vector<FileData> &files, const stdfs::path &parentDir, const stdfs::path &outPath, const std::string &extension, bool beVerbose)
 {
-    std::vector<FileData> result = files;
-    for (auto &file : result)
+    for (auto &file : files)
     {
         if (beVerbose)
         {
             std::cout << "File path: " << file.inPath << std::endl;
         }
-        // replace dots in file name with '_' and add a .c/.cpp extension
+        // replace dots in file name with '_' and add the extension
         std::string newFileName = file.inPath.filename().generic_string();
         std::replace(newFileName.begin(), newFileName.end(), '.', '_');
-        if (useC)
-        {
-            newFileName.append(".c");
-        }
-        else
-        {
-            newFileName.append(".cpp");
-        }
+        newFileName.append(extension);
         auto subPath = naiveRelative(file.inPath, parentDir);
         // add subdir below parent path to name to enable multiple files with the same name
         std::string subDirString(subPath.remove_filename().generic_string());
@@ -123,5 +203,81 @@ std::vector<FileData> generateOutputPaths(const std::vector<FileData> &files, co
             std::cout << "Output path: " << file.outPath << std::endl;
         }
     }
-    return result;
+}
+
+/// @brief Return the FNV-1a hash of the content of file, using the transformed content if there is one.
+static uint64_t contentHash(const FileData &file)
+{
+    if (file.transformedData)
+    {
+        return calculateFNV1a64(reinterpret_cast<const uint8_t *>(file.transformedData->data()), file.transformedData->size());
+    }
+    return calculateFNV1a64(file.inPath.string());
+}
+
+/// @brief Return the content of file, using the transformed content if there is one.
+static std::string fileContent(const FileData &file)
+{
+    if (file.transformedData)
+    {
+        return *file.transformedData;
+    }
+    std::ifstream inStream(file.inPath.string(), std::ios_base::in | std::ios_base::binary);
+    if (!inStream.is_open())
+    {
+        throw std::runtime_error("Failed to open " + file.inPath.string() + " for reading");
+    }
+    std::ostringstream content;
+    content << inStream.rdbuf();
+    return content.str();
+}
+
+/// @brief Returns true if the content of both files is the same, using the transformed content if there is one.
+static bool compareContent(const FileData &a, const FileData &b)
+{
+    if (!a.transformedData && !b.transformedData)
+    {
+        return compareFileContent(a.inPath, b.inPath);
+    }
+    return fileContent(a) == fileContent(b);
+}
+
+uint64_t markDuplicates(std::vector<FileData> &files, bool beVerbose)
+{
+    // group files by size. only files with the same size can have the same content
+    std::map<uint64_t, std::vector<std::size_t>> sizeGroups;
+    for (std::size_t index = 0; index < files.size(); ++index)
+    {
+        sizeGroups[files[index].size].push_back(index);
+    }
+    uint64_t bytesSaved = 0;
+    for (const auto &sizeGroup : sizeGroups)
+    {
+        if (sizeGroup.second.size() < 2)
+        {
+            continue;
+        }
+        // group files of the same size by hash. the first file with a hash is the original
+        std::map<uint64_t, std::vector<std::size_t>> hashGroups;
+        for (const auto index : sizeGroup.second)
+        {
+            const auto hash = sizeGroup.first > 0 ? contentHash(files[index]) : 0;
+            auto &originals = hashGroups[hash];
+            // hashes can collide, so compare content to all originals with the same hash
+            auto originalIt = std::find_if(originals.cbegin(), originals.cend(), [&](std::size_t original) { return compareContent(files[original], files[index]); });
+            if (originalIt == originals.cend())
+            {
+                originals.push_back(index);
+                continue;
+            }
+            files[index].isDuplicate = true;
+            files[index].outPath = files[*originalIt].outPath;
+            bytesSaved += files[index].size;
+            if (beVerbose)
+            {
+                std::cout << "File " << files[index].inPath << " is a duplicate of " << files[*originalIt].inPath << std::endl;
+            }
+        }
+    }
+    return bytesSaved;
 }
@@ -3,6 +3,7 @@
 #include "stdfs.h"
 
 #include <cstdint>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -15,26 +16,42 @@ struct FileData
     std::string dataVariableName;
     std::string sizeVariableName;
     uint64_t size = 0;
+    uint64_t compressedSize = 0; // !<Size of the compressed data if data is compressed, else 0.
+    bool isDuplicate = false; // !<True if another file has the same content. outPath is then the output path of that file.
+    bool isStream = false; // !<True if inPath is "-" (stdin) or a pipe. size is only known after all data has been read.
+    bool isArchived = false; // !<True if the file is stored in the hybrid archive instead of a data array.
+    std::shared_ptr<const std::string> transformedData; // !<Content after transforms were applied or nullptr if no transforms apply. size is its size.
 };
 
 /// @brief Fill the FileData structure with information about files on disk.
-/// @param inPath File or directory to get information for.
+/// Directories are read once and in parallel. Directories containing recursive symlinks are skipped.
+/// @param inPath Directory to get information for.
 /// @param parentDir Parent directory for files.
 /// @param recurse Recurse through subdirectories of inPath.
 /// @param beVerbose Output diagnoctic information to stdout.
-/// @return Returns information about files on disk in inPath.
-std::vector<FileData> getFileData(const stdfs::path &inPath, const stdfs::path &parentDir, bool recurse, bool beVerbose = false);
+/// @param nrOfThreads Number of threads to scan directories with.
+/// @param visitedDirectories If not nullptr, receives inPath and all subdirectories scanned, sorted by path.
+/// Files are added to or removed from these directories.
+/// @return Returns information about files on disk in inPath, sorted by inPath.
+std::vector<FileData> getFileData(const stdfs::path &inPath, const stdfs::path &parentDir, bool recurse, bool beVerbose = false, uint32_t nrOfThreads = 1, std::vector<stdfs::path> *visitedDirectories = nullptr);
 
 /// @brief Sort all FileData entries lexcographically by inPath using the path as long string.
-/// @param files Input files to sort.
-/// @return Return sorted files.
-std::vector<FileData> naiveSortByInPath(const std::vector<FileData> &files);
+/// @param files Input files to sort in place.
+void naiveSortByInPath(std::vector<FileData> &files);
 
 /// @brief Fill the FileData structure with information about file output paths.
-/// @param files Input files to add information to.
+/// @param files Input files to add information to in place.
 /// @param parentDir Parent directory for files.
 /// @param outPath Path output files are being written to.
-/// @param useC Generate output file names with ".c" extension instead of ".cpp".
+/// @param extension Extension for output file names including the dot, e.g. ".c" or ".cpp".
 /// @param beVerbose Output diagnoctic information to stdout.
-/// @return Return files updated with output information.
-std::vector<FileData> generateOutputPaths(const std::vector<FileData> &files, const stdfs::path &parentDir, const stdfs::path &outPath, bool useC, bool beVerbose = false);
+void generateOutputPaths(std::vector<FileData> &files, const stdfs::path &parentDir, const stdfs::path &outPath, const std::string &extension, bool beVerbose = false);
+
+/// @brief Find files with the same content. Files are grouped by size first, then files of the same size are hashed and
+/// compared. All files, but the first, with the same content are marked as duplicates and get the output path of the first
+/// file, so they use the same variables.
+/// @param files Input files with output information.
+/// @param beVerbose Output diagnoctic information to stdout.
+/// @return Returns the number of bytes saved by not storing duplicates.
+/// @throw std::runtime_error if a file can't be read.
+uint64_t markDuplicates(std::vector<FileData> &files, bool beVerbose = false);
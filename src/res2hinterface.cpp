@@ -21,7 +21,7 @@ bool operator!=(const Res2h::ResourceInfo &a, const Res2h::ResourceInfo &b)
 
 bool operator==(const Res2h::ArchiveInfo &a, const Res2h::ArchiveInfo &b)
 {
-    return a.offsetInFile == b.offsetInFile && a.fileVersion == b.fileVersion && a.formatFlags == b.formatFlags && a.bits == b.bits && a.size == b.size && a.checksum == b.checksum && a.filePath == b.filePath;
+    return a.offsetInFile == b.offsetInFile && a.fileVersion == b.fileVersion && a.formatFlags == b.formatFlags && a.bits == b.bits && a.dataAlignment == b.dataAlignment && a.size == b.size && a.checksum == b.checksum && a.filePath == b.filePath;
 }
 
 bool operator!=(const Res2h::ArchiveInfo &a, const Res2h::ArchiveInfo &b)
@@ -64,30 +64,36 @@ uint64_t Res2h::findArchiveStartOffset(const std::string &archivePath) const
     }
     // no magic bytes at start. might be an embedded archive, search for a header backwards from EOF...
     std::array<char, 4096> buffer{};
-    // seek to end minus buffer size
-    inStream.seekg(sizeof(buffer), std::ios::end);
-    // read whole file to search for archive
-    while (inStream.good())
-    {
-        // read block of data and convert to string
-        inStream.read(reinterpret_cast<char *>(buffer.data()), sizeof(buffer));
-        std::string haystack(reinterpret_cast<char *>(buffer.data()), sizeof(buffer));
+    inStream.clear();
+    inStream.seekg(0, std::ios::end);
+    uint64_t blockEnd = static_cast<uint64_t>(inStream.tellg());
+    while (blockEnd > 0)
+    {
+        // read block of data before blockEnd and convert to string
+        const uint64_t blockStart = blockEnd > sizeof(buffer) ? blockEnd - sizeof(buffer) : 0;
+        inStream.seekg(static_cast<std::streamoff>(blockStart));
+        inStream.read(reinterpret_cast<char *>(buffer.data()), static_cast<std::streamsize>(blockEnd - blockStart));
+        if (!inStream.good())
+        {
+            break;
+        }
+        std::string haystack(reinterpret_cast<char *>(buffer.data()), static_cast<std::size_t>(blockEnd - blockStart));
         // try to find magic bytes
         auto magicPosition = haystack.rfind(RES2H_MAGIC_BYTES);
         if (magicPosition != std::string::npos)
         {
             // found. close and return offset
             inStream.close();
-            return static_cast<uint64_t>(inStream.tellg()) + magicPosition;
+            return blockStart + magicPosition;
         }
         // check if we're already at the start of the stream
-        if (inStream.tellg() == std::streampos(0))
+        if (blockStart == 0)
         {
             break;
         }
-        // no. seek the size of the buffer in direction of the start of the file,
-        // but read some bytes again, else we could miss the header in between buffer
-        inStream.seekg(-static_cast<int64_t>(sizeof(buffer) - sizeof(RES2H_MAGIC_BYTES) + 1), std::ios::cur);
+        // no. move the block in direction of the start of the file,
+        // but read some bytes again, else we could miss the header in between blocks
+        blockEnd = blockStart + sizeof(RES2H_MAGIC_BYTES) - 2;
     }
     // close file. nothing found.
     inStream.close();
@@ -108,7 +114,6 @@ Res2h::ArchiveInfo Res2h::archiveInfo(const std::string &archivePath) const
     ArchiveInfo info;
     info.filePath = archivePath;
     info.offsetInFile = findArchiveStartOffset(archivePath);
-    const std::streamsize nrOfBytesSizeOrChecksum = info.bits == 64 ? sizeof(uint64_t) : sizeof(uint32_t);
     // open archive again
     std::ifstream inStream;
     inStream.open(archivePath, std::ios_base::in | std::ios_base::binary);
@@ -128,12 +133,21 @@ Res2h::ArchiveInfo Res2h::archiveInfo(const std::string &archivePath) const
     inStream.seekg(static_cast<std::streamoff>(info.offsetInFile + RES2H_OFFSET_FORMAT_FLAGS));
     inStream.read(reinterpret_cast<char *>(&info.formatFlags), sizeof(uint32_t));
     // the low 8 bit of the flags is the archive bit depth, e.g. 32/64 bit
-    info.bits = info.formatFlags & 0x000000FF;
+    info.bits = info.formatFlags & RES2H_FORMAT_BITS_MASK;
     if (info.bits != 32 && info.bits != 64)
     {
         inStream.close();
         throw Res2hException("Unsupported archive bit depth");
     }
+    // the next 8 bit are log2 of the alignment of resource data
+    const uint32_t alignmentShift = (info.formatFlags & RES2H_FORMAT_ALIGNMENT_MASK) >> RES2H_FORMAT_ALIGNMENT_SHIFT;
+    if (alignmentShift >= 64)
+    {
+        inStream.close();
+        throw Res2hException("Unsupported data alignment");
+    }
+    info.dataAlignment = static_cast<uint64_t>(1) << alignmentShift;
+    const std::streamsize nrOfBytesSizeOrChecksum = info.bits == 64 ? sizeof(uint64_t) : sizeof(uint32_t);
     // get size of the whole archive.
     uint64_t archiveSize = 0;
     inStream.seekg(static_cast<std::streamoff>(info.offsetInFile + RES2H_OFFSET_ARCHIVE_SIZE));
@@ -151,7 +165,7 @@ Res2h::ArchiveInfo Res2h::archiveInfo(const std::string &archivePath) const
     info.checksum = readChecksum;
     // control checksum. close first for calling checksum function
     inStream.close();
-    uint64_t fileChecksum = (info.bits == 64 ? calculateFletcher<uint64_t>(archivePath, info.size - sizeof(uint64_t)) : calculateFletcher<uint32_t>(archivePath, static_cast<uint32_t>(info.size - sizeof(uint32_t))));
+    uint64_t fileChecksum = (info.bits == 64 ? calculateFletcher<uint64_t>(archivePath, info.size - sizeof(uint64_t), 0, info.offsetInFile) : calculateFletcher<uint32_t>(archivePath, static_cast<uint32_t>(info.size - sizeof(uint32_t)), 0, info.offsetInFile));
     if (info.checksum != fileChecksum)
     {
         throw Res2hException("Archive has a bad checksum");
@@ -188,6 +202,7 @@ bool Res2h::loadArchive(const std::string &archivePath)
             ++aIt;
         }
     }
+    rebuildResourceIds();
     // try to find archive in file. this will throw if it fails
     ArchiveInfo info = archiveInfo(archivePath);
     // open archive
@@ -228,9 +243,71 @@ bool Res2h::loadArchive(const std::string &archivePath)
     // close file and add entry
     inStream.close();
     m_archives.push_back(entry);
+    try
+    {
+        rebuildResourceIds();
+    }
+    catch (const Res2hException & /*e*/)
+    {
+        // don't keep an archive that can't be accessed by ID
+        m_archives.pop_back();
+        rebuildResourceIds();
+        throw;
+    }
     return true;
 }
 
+void Res2h::rebuildResourceIds()
+{
+    m_resourceIds.clear();
+    for (std::size_t archiveIndex = 0; archiveIndex < m_archives.size(); ++archiveIndex)
+    {
+        const auto &resources = m_archives[archiveIndex].resources;
+        for (std::size_t resourceIndex = 0; resourceIndex < resources.size(); ++resourceIndex)
+        {
+            const auto &filePath = resources[resourceIndex].filePath;
+            const auto id = calculateFNV1a64(reinterpret_cast<const uint8_t *>(filePath.data()), filePath.size());
+            const auto inserted = m_resourceIds.emplace(id, std::make_pair(archiveIndex, resourceIndex));
+            if (!inserted.second)
+            {
+                const auto &existing = m_archives[inserted.first->second.first].resources[inserted.first->second.second];
+                if (existing.filePath != filePath)
+                {
+                    m_resourceIds.clear();
+                    throw Res2hException("Resource ID collision in archive");
+                }
+            }
+        }
+    }
+}
+
+Res2h::ResourceInfo Res2h::loadCachedResource(ResourceInfo &resource, const ArchiveInfo &archive, bool keepInCache, bool checkChecksum)
+{
+    // check if data is in memory
+    if (!resource.data.empty())
+    {
+        return resource;
+    }
+    // no. load data first
+    auto tempEntry = loadResourceFromArchive(resource, archive, checkChecksum);
+    if (keepInCache)
+    {
+        resource = tempEntry;
+    }
+    return tempEntry;
+}
+
+Res2h::ResourceInfo Res2h::loadResource(ResourceId id, bool keepInCache, bool checkChecksum)
+{
+    const auto idIt = m_resourceIds.find(id);
+    if (idIt == m_resourceIds.cend())
+    {
+        throw Res2hException("Failed to load file from archive");
+    }
+    auto &entry = m_archives[idIt->second.first];
+    return loadCachedResource(entry.resources[idIt->second.second], entry.archive, keepInCache, checkChecksum);
+}
+
 Res2h::ResourceInfo Res2h::loadResource(const std::string &filePath, bool keepInCache, bool checkChecksum)
 {
     ResourceInfo temp;
@@ -244,18 +321,8 @@ Res2h::ResourceInfo Res2h::loadResource(const std::string &filePath, bool keepIn
             {
                 if (resource.filePath == filePath)
                 {
-                    // file found. check if data is in memory
-                    if (!resource.data.empty())
-                    {
-                        return resource;
-                    }
-                    // no. load data first
-                    auto tempEntry = loadResourceFromArchive(resource, entry.archive, checkChecksum);
-                    if (keepInCache)
-                    {
-                        resource = tempEntry;
-                    }
-                    return tempEntry;
+                    // file found
+                    return loadCachedResource(resource, entry.archive, keepInCache, checkChecksum);
                 }
             }
         }
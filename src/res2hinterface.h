@@ -4,6 +4,8 @@
 #include <exception>
 #include <functional>
 #include <string>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include "checksum.h"
@@ -33,6 +35,10 @@ class Res2hException final : public std::runtime_error
 class Res2h
 {
   public:
+    /// @brief ID of a resource in an archive. It is the 64bit FNV-1a hash of the file name, e.g. ":/a.x".
+    /// Get it at compile time using resourceId() or from the header res2h writes with "-b -h".
+    using ResourceId = uint64_t;
+
     struct ResourceInfo
     {
         std::string filePath; // !<Name of file. If it starts with ":/" it is considered an internal file in a binary res2h archive.
@@ -56,6 +62,7 @@ class Res2h
         uint8_t bits = 0; // !<Archive bit depth (32/64).
         uint64_t size = 0; // !<Overall size of archive data.
         uint64_t checksum = 0; // !<Fletcher-32/64 archive checksum.
+        uint64_t dataAlignment = 1; // !<Alignment of the data of non-empty resources relative to the archive start in bytes.
 
         /// @brief Compare a and b for equality.
         friend bool operator==(const ArchiveInfo &a, const ArchiveInfo &b);
@@ -63,6 +70,18 @@ class Res2h
         friend bool operator!=(const ArchiveInfo &a, const ArchiveInfo &b);
     };
 
+    /// @brief Return the ID of the resource with the name filePath, e.g. ":/a.x".
+    /// @note Same as calculateFNV1a64() over the characters of filePath, but usable in constant expressions.
+    static constexpr ResourceId resourceId(const char *filePath)
+    {
+        ResourceId hash = FNV1A64_OFFSET_BASIS;
+        for (; *filePath != '\0'; ++filePath)
+        {
+            hash = (hash ^ static_cast<uint8_t>(*filePath)) * 0x100000001b3ULL;
+        }
+        return hash;
+    }
+
     /// @brief Return an instance of the singleton Res2h object.
     /// @return The Res2h object.
     static Res2h &instance();
@@ -97,6 +116,15 @@ class Res2h
     /// @throw Throws a Res2hException file can't be found on disk / in an archive or the archive is corrupted.
     ResourceInfo loadResource(const std::string &filePath, bool keepInCache = false, bool checkChecksum = true);
 
+    /// @brief Load resource / file content from a binary archive by its ID. This looks up the resource in a hash table
+    /// built when loading the archive and does not compare or hash names.
+    /// @param id ID of the resource, e.g. resourceId(":/a.x").
+    /// @param keepInCache Optional. Pass true to keep the resource in memory if you need it more than once.
+    /// @param checkChecksum Optional. Pass true to check the calculated checksum of the data against the checksum stored in the archive.
+    /// @return Returns a struct containing the data or throws an exception if it fails to do so.
+    /// @throw Throws a Res2hException if no loaded archive contains the resource or the archive is corrupted.
+    ResourceInfo loadResource(ResourceId id, bool keepInCache = false, bool checkChecksum = true);
+
     /// @brief Return information about all resources on disk and in archive, loaded or not.
     /// @return Returns information about all resources on disk and in archive, loaded or not.
     /// @note This returns const references to the resources, so no raw data is not copied.
@@ -117,6 +145,11 @@ class Res2h
     /// @brief Load a resource from a binary archive.
     /// @throw Throws a Res2hException file can't be found in an archive or the archive is corrupted.
     static ResourceInfo loadResourceFromArchive(const ResourceInfo &entry, const ArchiveInfo &archive, bool checkChecksum);
+    /// @brief Return the cached data of resource or load it from archive and cache it if keepInCache is true.
+    static ResourceInfo loadCachedResource(ResourceInfo &resource, const ArchiveInfo &archive, bool keepInCache, bool checkChecksum);
+    /// @brief Rebuild the map from resource IDs to archive resources after archives were added or removed.
+    /// @throw Throws a Res2hException if resources with different names have the same ID.
+    void rebuildResourceIds();
 
     /// @brief Holds archive information and resources.
     struct ArchiveEntry
@@ -127,6 +160,8 @@ class Res2h
 
     /// @brief Cache holding the archive entries.
     std::vector<ArchiveEntry> m_archives;
+    /// @brief Index of archive and resource in m_archives for every resource ID. If multiple archives contain a resource, the first one is used.
+    std::unordered_map<ResourceId, std::pair<std::size_t, std::size_t>> m_resourceIds;
     /// @brief Cache holding the on-disk resources.
     std::vector<ResourceInfo> m_diskResources;
 };
@@ -0,0 +1,115 @@
+#include "res2hmanifest.h"
+
+#include "checksum.h"
+#include "stdfshelpers.h"
+
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+static const std::string manifestMagic = "res2h manifest 2";
+static const std::string optionsPrefix = "options ";
+
+Manifest readManifest(const stdfs::path &manifestPath)
+{
+    Manifest manifest;
+    if (!stdfs::exists(manifestPath))
+    {
+        return manifest;
+    }
+    std::ifstream inStream;
+    inStream.open(manifestPath.string(), std::ios_base::in);
+    if (!inStream.is_open() || !inStream.good())
+    {
+        throw std::runtime_error("Failed to open manifest for reading");
+    }
+    // check header
+    std::string line;
+    if (!std::getline(inStream, line) || line != manifestMagic)
+    {
+        throw std::runtime_error("Not a res2h manifest");
+    }
+    if (!std::getline(inStream, line) || line.compare(0, optionsPrefix.size(), optionsPrefix) != 0)
+    {
+        throw std::runtime_error("Manifest options missing");
+    }
+    manifest.options = line.substr(optionsPrefix.size());
+    // read entries. each line is "size <TAB> modification time <TAB> hash <TAB> compressed size <TAB> input path <TAB> output path"
+    while (std::getline(inStream, line))
+    {
+        std::istringstream lineStream(line);
+        std::string inPath;
+        std::string outPath;
+        ManifestEntry entry;
+        lineStream >> entry.size >> entry.modificationTime >> std::hex >> entry.hash >> std::dec >> entry.compressedSize;
+        if (lineStream.get() != '\t' || !std::getline(lineStream, inPath, '\t') || !std::getline(lineStream, outPath) || inPath.empty() || outPath.empty())
+        {
+            throw std::runtime_error("Invalid manifest entry \"" + line + "\"");
+        }
+        entry.outPath = outPath;
+        manifest.entries[inPath] = entry;
+    }
+    return manifest;
+}
+
+void writeManifest(const stdfs::path &manifestPath, const Manifest &manifest)
+{
+    // write to temporary file first, so the manifest is not touched if nothing changed
+    const stdfs::path tempPath = manifestPath.string() + ".tmp";
+    std::ofstream outStream;
+    outStream.open(tempPath.string(), std::ofstream::out | std::ofstream::trunc);
+    if (!outStream.is_open() || !outStream.good())
+    {
+        throw std::runtime_error("Failed to open manifest for writing");
+    }
+    outStream << manifestMagic << std::endl;
+    outStream << optionsPrefix << manifest.options << std::endl;
+    for (const auto &entry : manifest.entries)
+    {
+        outStream << std::dec << entry.second.size << '\t' << entry.second.modificationTime << '\t' << std::hex << entry.second.hash << '\t' << std::dec << entry.second.compressedSize << '\t';
+        outStream << entry.first << '\t' << entry.second.outPath.generic_string() << std::endl;
+    }
+    outStream.close();
+    if (!outStream.good())
+    {
+        throw std::runtime_error("Failed to write manifest");
+    }
+    replaceFileIfChanged(manifestPath, tempPath);
+}
+
+ManifestEntry createManifestEntry(const FileData &file, const Manifest &previous)
+{
+    ManifestEntry entry;
+    entry.outPath = file.outPath;
+    entry.size = file.size;
+    try
+    {
+        entry.modificationTime = static_cast<int64_t>(stdfs::last_write_time(file.inPath).time_since_epoch().count());
+    }
+    catch (const stdfs::filesystem_error &e)
+    {
+        throw std::runtime_error(e.what());
+    }
+    // only read file if it might have changed
+    const auto previousEntry = previous.entries.find(file.inPath.generic_string());
+    if (previousEntry != previous.entries.cend() && previousEntry->second.size == entry.size && previousEntry->second.modificationTime == entry.modificationTime)
+    {
+        entry.hash = previousEntry->second.hash;
+    }
+    else
+    {
+        entry.hash = calculateFNV1a64(file.inPath.string());
+    }
+    return entry;
+}
+
+bool isUnchanged(const FileData &file, const ManifestEntry &current, const Manifest &previous)
+{
+    const auto previousEntry = previous.entries.find(file.inPath.generic_string());
+    if (previousEntry == previous.entries.cend())
+    {
+        return false;
+    }
+    const auto &entry = previousEntry->second;
+    return entry.size == current.size && entry.hash == current.hash && entry.outPath == current.outPath && stdfs::exists(current.outPath);
+}
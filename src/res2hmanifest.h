@@ -0,0 +1,43 @@
+// Manifest of input files used to skip conversion of files that did not change since the last run
+#pragma once
+
+#include "res2hhelpers.h"
+#include "stdfs.h"
+
+#include <cstdint>
+#include <map>
+#include <string>
+
+/// @brief State of an input file when it was last converted.
+struct ManifestEntry
+{
+    stdfs::path outPath; // !<Output file the input was converted to.
+    uint64_t size = 0; // !<Size of input file in bytes.
+    int64_t modificationTime = 0; // !<Last modification time of input file in file clock ticks.
+    uint64_t hash = 0; // !<FNV-1a hash of input file content.
+    uint64_t compressedSize = 0; // !<Size of the compressed data in the output file if data is compressed, else 0.
+};
+
+/// @brief Information about all input files of a res2h run.
+struct Manifest
+{
+    std::string options; // !<Options that influence the output. If they change, all files must be converted again.
+    std::map<std::string, ManifestEntry> entries; // !<Entries by generic input path.
+};
+
+/// @brief Read manifest from file.
+/// @return Returns the manifest read or an empty manifest if the file does not exist.
+/// @throw std::runtime_error if the file can't be read or is not a valid manifest.
+Manifest readManifest(const stdfs::path &manifestPath);
+
+/// @brief Write manifest to file. The file is only replaced if its content changes.
+/// @throw std::runtime_error if the file can't be written.
+void writeManifest(const stdfs::path &manifestPath, const Manifest &manifest);
+
+/// @brief Create the manifest entry for the current state of file. The content hash is taken from the
+/// entry in previous if size and modification time did not change, else the file is read to calculate it.
+/// @throw std::runtime_error if the file can't be read.
+ManifestEntry createManifestEntry(const FileData &file, const Manifest &previous);
+
+/// @brief Returns true if file was converted to the same output with the same content as stored in the entry in previous.
+bool isUnchanged(const FileData &file, const ManifestEntry &current, const Manifest &previous);
@@ -0,0 +1,106 @@
+#include "res2hregistry.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__ELF__)
+// defined by the linker if any entry was linked in. weak, so linking succeeds if there are none
+extern const Res2hRegistryEntry __start_res2h_entries[] __attribute__((weak));
+extern const Res2hRegistryEntry __stop_res2h_entries[] __attribute__((weak));
+#endif
+
+/// @brief Entries sorted by relative file name.
+typedef struct Res2hRegistryIndex
+{
+    uint32_t nrOfEntries;
+    const Res2hRegistryEntry * entries[];
+} Res2hRegistryIndex;
+
+static Res2hRegistryIndex * res2hRegistryIndex = 0;
+
+static int compareEntries(const void * a, const void * b)
+{
+    const Res2hRegistryEntry * entryA = *(const Res2hRegistryEntry * const *)a;
+    const Res2hRegistryEntry * entryB = *(const Res2hRegistryEntry * const *)b;
+    return strcmp(entryA->relativeFileName, entryB->relativeFileName);
+}
+
+/// @brief Return the index of all entries, building it on first use.
+/// Threads calling this concurrently may both build an index, but only one is kept. No locks or constructors are needed.
+static const Res2hRegistryIndex * getIndex(void)
+{
+    Res2hRegistryIndex * index = __atomic_load_n(&res2hRegistryIndex, __ATOMIC_ACQUIRE);
+    if (index != 0)
+    {
+        return index;
+    }
+    uint32_t nrOfEntries = 0;
+#if defined(__ELF__)
+    if (__start_res2h_entries != 0 && __stop_res2h_entries != 0)
+    {
+        nrOfEntries = (uint32_t)(__stop_res2h_entries - __start_res2h_entries);
+    }
+#endif
+    index = (Res2hRegistryIndex *)malloc(sizeof(Res2hRegistryIndex) + nrOfEntries * sizeof(const Res2hRegistryEntry *));
+    if (index == 0)
+    {
+        return 0;
+    }
+    index->nrOfEntries = nrOfEntries;
+#if defined(__ELF__)
+    for (uint32_t i = 0; i < nrOfEntries; ++i)
+    {
+        index->entries[i] = &__start_res2h_entries[i];
+    }
+#endif
+    qsort(index->entries, nrOfEntries, sizeof(const Res2hRegistryEntry *), compareEntries);
+    // publish the index. if another thread was faster, use its index instead
+    Res2hRegistryIndex * expected = 0;
+    if (!__atomic_compare_exchange_n(&res2hRegistryIndex, &expected, index, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+    {
+        free(index);
+        return expected;
+    }
+    return index;
+}
+
+uint32_t res2hRegistryCount(void)
+{
+    const Res2hRegistryIndex * index = getIndex();
+    return index != 0 ? index->nrOfEntries : 0;
+}
+
+const Res2hRegistryEntry * res2hRegistryEntry(uint32_t index)
+{
+    const Res2hRegistryIndex * registryIndex = getIndex();
+    return (registryIndex != 0 && index < registryIndex->nrOfEntries) ? registryIndex->entries[index] : 0;
+}
+
+const Res2hRegistryEntry * res2hRegistryFind(const char * relativeFileName)
+{
+    const Res2hRegistryIndex * index = getIndex();
+    if (index == 0 || relativeFileName == 0)
+    {
+        return 0;
+    }
+    uint32_t first = 0;
+    uint32_t last = index->nrOfEntries;
+    while (first < last)
+    {
+        const uint32_t middle = first + (last - first) / 2;
+        const int result = strcmp(index->entries[middle]->relativeFileName, relativeFileName);
+        if (result == 0)
+        {
+            return index->entries[middle];
+        }
+        if (result < 0)
+        {
+            first = middle + 1;
+        }
+        else
+        {
+            last = middle;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+// Runtime for resources converted with "res2h --register". Every generated .c/.cpp file puts an entry for its
+// resource into the linker section "res2h_entries". The functions here find all entries linked into the
+// executable or shared library using the __start_ / __stop_ symbols of the section on ELF targets and index
+// them on first use. There are no static constructors and no common utilities file needs to be generated.
+// Compile res2hregistry.c once per executable / shared library. Entries in static libraries are only linked
+// if something else in their object file is referenced, so link resources as object files or whole archives.
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef RES2H_REGISTRY_ENTRY_DEFINED
+#define RES2H_REGISTRY_ENTRY_DEFINED
+/* Entry generated files put into the "res2h_entries" section. Generated files define the same struct */
+typedef struct Res2hRegistryEntry
+{
+    const char * relativeFileName;
+    uint64_t size;
+    const uint8_t * data;
+} Res2hRegistryEntry;
+#endif
+
+/// @brief Return the number of resources linked into the executable / shared library.
+/// @note Returns 0 on non-ELF targets or if the index could not be allocated.
+uint32_t res2hRegistryCount(void);
+
+/// @brief Return the resource at index, with resources sorted by relative file name.
+/// @return Returns a null pointer if index is out of range.
+const Res2hRegistryEntry * res2hRegistryEntry(uint32_t index);
+
+/// @brief Find resource by relative file name, e.g. ":/a.x", using binary search.
+/// @return Returns a null pointer if not found. If resources with the same name are linked in, any of them is returned.
+const Res2hRegistryEntry * res2hRegistryFind(const char * relativeFileName);
+
+#ifdef __cplusplus
+}
+#endif
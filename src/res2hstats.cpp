@@ -0,0 +1,135 @@
+#include "res2hstats.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <stdexcept>
+
+double secondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+double megabytesPerSecond(const StatsEntry &entry)
+{
+    return entry.seconds > 0 ? static_cast<double>(entry.bytes) / 1000000.0 / entry.seconds : 0;
+}
+
+std::vector<StatsEntry> slowestEntries(const std::vector<StatsEntry> &entries, std::size_t count)
+{
+    auto result = entries;
+    std::stable_sort(result.begin(), result.end(), [](const StatsEntry &a, const StatsEntry &b) { return a.seconds > b.seconds; });
+    result.resize(std::min(count, result.size()));
+    return result;
+}
+
+/// @brief Print one table row. The name comes last, because paths can be long.
+/// Phases that do not process data get no byte count and throughput.
+static void printEntry(std::ostream &outStream, const StatsEntry &entry)
+{
+    outStream << std::fixed << std::setprecision(6) << std::setw(12) << entry.seconds;
+    if (entry.bytes > 0)
+    {
+        outStream << std::setw(16) << entry.bytes << std::setprecision(1) << std::setw(12) << megabytesPerSecond(entry);
+    }
+    else
+    {
+        outStream << std::setw(16) << "-" << std::setw(12) << "-";
+    }
+    outStream << "  " << entry.name << std::endl;
+}
+
+void printStats(std::ostream &outStream, const Stats &stats, std::size_t nrOfFiles)
+{
+    const auto flags = outStream.flags();
+    const auto precision = outStream.precision();
+    outStream << std::endl
+              << std::right << std::setw(12) << "Time [s]" << std::setw(16) << "Bytes" << std::setw(12) << "MB/s" << "  Phase" << std::endl;
+    for (const auto &phase : stats.phases)
+    {
+        printEntry(outStream, phase);
+    }
+    const auto slowestFiles = slowestEntries(stats.files, nrOfFiles);
+    if (!slowestFiles.empty())
+    {
+        outStream << std::endl
+                  << "Slowest " << slowestFiles.size() << " of " << stats.files.size() << " files:" << std::endl;
+        for (const auto &file : slowestFiles)
+        {
+            printEntry(outStream, file);
+        }
+    }
+    outStream.flags(flags);
+    outStream.precision(precision);
+}
+
+/// @brief Write a string as JSON string literal, escaping quotes, backslashes and control characters.
+static void writeJsonString(std::ostream &outStream, const std::string &value)
+{
+    outStream << "\"";
+    for (const auto c : value)
+    {
+        if (c == '"' || c == '\\')
+        {
+            outStream << "\\" << c;
+        }
+        else if (static_cast<unsigned char>(c) < 0x20)
+        {
+            outStream << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(c) << std::dec << std::setfill(' ');
+        }
+        else
+        {
+            outStream << c;
+        }
+    }
+    outStream << "\"";
+}
+
+/// @brief Write entries as JSON array of objects holding name, seconds, bytes and MB/s.
+static void writeJsonEntries(std::ostream &outStream, const std::vector<StatsEntry> &entries)
+{
+    outStream << "[";
+    for (std::size_t index = 0; index < entries.size(); ++index)
+    {
+        const auto &entry = entries[index];
+        outStream << (index > 0 ? "," : "") << std::endl
+                  << "    {\"name\": ";
+        writeJsonString(outStream, entry.name);
+        outStream << ", \"seconds\": " << entry.seconds << ", \"bytes\": " << entry.bytes << ", \"mbPerSecond\": " << megabytesPerSecond(entry) << "}";
+    }
+    outStream << (entries.empty() ? "]" : "\n  ]");
+}
+
+void writeStatsJson(std::ostream &outStream, const Stats &stats, std::size_t nrOfFiles)
+{
+    const auto flags = outStream.flags();
+    const auto precision = outStream.precision();
+    outStream << std::fixed << std::setprecision(6);
+    outStream << "{" << std::endl
+              << "  \"phases\": ";
+    writeJsonEntries(outStream, stats.phases);
+    outStream << "," << std::endl
+              << "  \"nrOfFiles\": " << stats.files.size() << "," << std::endl
+              << "  \"slowestFiles\": ";
+    writeJsonEntries(outStream, slowestEntries(stats.files, nrOfFiles));
+    outStream << std::endl
+              << "}" << std::endl;
+    outStream.flags(flags);
+    outStream.precision(precision);
+}
+
+void writeStatsJson(const stdfs::path &jsonPath, const Stats &stats, std::size_t nrOfFiles)
+{
+    std::ofstream outStream;
+    outStream.open(jsonPath.string(), std::ofstream::out | std::ofstream::trunc);
+    if (!outStream.is_open() || !outStream.good())
+    {
+        throw std::runtime_error("Failed to open statistics file for writing");
+    }
+    writeStatsJson(outStream, stats, nrOfFiles);
+    outStream.close();
+    if (outStream.fail())
+    {
+        throw std::runtime_error("Failed to write statistics file");
+    }
+}
@@ -0,0 +1,44 @@
+// Wall time and throughput of res2h phases and files reported with --stats
+#pragma once
+
+#include "stdfs.h"
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/// @brief Time spent on a phase of a res2h run or on a single file.
+struct StatsEntry
+{
+    std::string name; // !<Name of the phase or input path of the file.
+    double seconds = 0; // !<Wall time in seconds.
+    uint64_t bytes = 0; // !<Number of bytes processed. 0 if the phase does not process input data.
+};
+
+/// @brief Timing information of a res2h run.
+struct Stats
+{
+    std::vector<StatsEntry> phases; // !<Phases in the order they ran.
+    std::vector<StatsEntry> files; // !<Files in the order they were processed.
+};
+
+/// @brief Return the wall time in seconds passed since start.
+double secondsSince(std::chrono::steady_clock::time_point start);
+
+/// @brief Return the throughput of an entry in MB/s (10^6 bytes per second) or 0 if it took no measurable time.
+double megabytesPerSecond(const StatsEntry &entry);
+
+/// @brief Return the count entries that took the most time, slowest first. Entries with the same time keep their order.
+std::vector<StatsEntry> slowestEntries(const std::vector<StatsEntry> &entries, std::size_t count);
+
+/// @brief Print a table of all phases and the nrOfFiles slowest files to outStream.
+void printStats(std::ostream &outStream, const Stats &stats, std::size_t nrOfFiles);
+
+/// @brief Write all phases and the nrOfFiles slowest files as JSON object to outStream.
+void writeStatsJson(std::ostream &outStream, const Stats &stats, std::size_t nrOfFiles);
+
+/// @brief Write all phases and the nrOfFiles slowest files as JSON object to the file jsonPath.
+/// @throw std::runtime_error if the file can't be written.
+void writeStatsJson(const stdfs::path &jsonPath, const Stats &stats, std::size_t nrOfFiles);
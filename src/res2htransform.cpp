@@ -0,0 +1,280 @@
+#include "res2htransform.h"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cerrno>
+#endif
+
+void minifyWhitespace(std::string &data)
+{
+    std::string result;
+    result.reserve(data.size());
+    std::size_t lineStart = 0;
+    while (lineStart < data.size())
+    {
+        auto lineEnd = data.find('\n', lineStart);
+        const bool hasLineBreak = lineEnd != std::string::npos;
+        if (!hasLineBreak)
+        {
+            lineEnd = data.size();
+        }
+        const auto first = data.find_first_not_of(" \t\r\f\v", lineStart);
+        if (first != std::string::npos && first < lineEnd)
+        {
+            const auto last = data.find_last_not_of(" \t\r\f\v", lineEnd - 1);
+            result.append(data, first, last + 1 - first);
+            if (hasLineBreak)
+            {
+                result += '\n';
+            }
+        }
+        lineStart = lineEnd + 1;
+    }
+    data.swap(result);
+}
+
+void trimTrailingZeros(std::string &data)
+{
+    const auto last = data.find_last_not_of('\0');
+    data.resize(last == std::string::npos ? 0 : last + 1);
+}
+
+/// @brief Read a big-endian 32 bit value as used in PNG files.
+static uint32_t readPngUint32(const std::string &data, std::size_t offset)
+{
+    const auto bytes = reinterpret_cast<const uint8_t *>(data.data() + offset);
+    return (static_cast<uint32_t>(bytes[0]) << 24) | (static_cast<uint32_t>(bytes[1]) << 16) | (static_cast<uint32_t>(bytes[2]) << 8) | static_cast<uint32_t>(bytes[3]);
+}
+
+void stripPngMetadata(std::string &data)
+{
+    static const std::string signature = "\x89PNG\r\n\x1a\n";
+    static const std::array<const char *, 5> metadataChunks = {"tEXt", "zTXt", "iTXt", "tIME", "eXIf"};
+    if (data.compare(0, signature.size(), signature) != 0)
+    {
+        throw std::runtime_error("Not a PNG file");
+    }
+    // every chunk is length, type, data and CRC. copy all chunks up to IEND, except metadata
+    std::string result = signature;
+    std::size_t offset = signature.size();
+    bool foundEnd = false;
+    while (!foundEnd)
+    {
+        if (data.size() - offset < 12)
+        {
+            throw std::runtime_error("PNG file is truncated");
+        }
+        const uint64_t chunkSize = 12 + static_cast<uint64_t>(readPngUint32(data, offset));
+        if (data.size() - offset < chunkSize)
+        {
+            throw std::runtime_error("PNG file is truncated");
+        }
+        const auto type = data.substr(offset + 4, 4);
+        foundEnd = type == "IEND";
+        if (std::find(metadataChunks.cbegin(), metadataChunks.cend(), type) == metadataChunks.cend())
+        {
+            result.append(data, offset, static_cast<std::size_t>(chunkSize));
+        }
+        offset += static_cast<std::size_t>(chunkSize);
+    }
+    data.swap(result);
+}
+
+#if defined(_WIN32)
+void runTransformCommand(const std::string & /*command*/, std::string & /*data*/)
+{
+    throw std::runtime_error("Transform commands are not supported on Windows");
+}
+#else
+/// @brief Create a pipe whose descriptors are closed in child processes, so commands started by other threads don't keep it open.
+static void createPipe(std::array<int, 2> &descriptors)
+{
+#if defined(__linux__)
+    if (pipe2(descriptors.data(), O_CLOEXEC) != 0)
+    {
+        throw std::runtime_error(std::string("Failed to create pipe: ") + std::strerror(errno));
+    }
+#else
+    if (pipe(descriptors.data()) != 0)
+    {
+        throw std::runtime_error(std::string("Failed to create pipe: ") + std::strerror(errno));
+    }
+    fcntl(descriptors[0], F_SETFD, FD_CLOEXEC);
+    fcntl(descriptors[1], F_SETFD, FD_CLOEXEC);
+#endif
+}
+
+void runTransformCommand(const std::string &command, std::string &data)
+{
+    std::array<int, 2> inPipe{};
+    std::array<int, 2> outPipe{};
+    createPipe(inPipe);
+    try
+    {
+        createPipe(outPipe);
+    }
+    catch (const std::runtime_error & /*e*/)
+    {
+        close(inPipe[0]);
+        close(inPipe[1]);
+        throw;
+    }
+    const pid_t pid = fork();
+    if (pid == 0)
+    {
+        // child. only async-signal-safe functions may be used here, because the parent has threads
+        if (dup2(inPipe[0], STDIN_FILENO) < 0 || dup2(outPipe[1], STDOUT_FILENO) < 0)
+        {
+            _exit(127);
+        }
+        execl("/bin/sh", "sh", "-c", command.c_str(), static_cast<char *>(nullptr));
+        _exit(127);
+    }
+    close(inPipe[0]);
+    close(outPipe[1]);
+    if (pid < 0)
+    {
+        close(inPipe[1]);
+        close(outPipe[0]);
+        throw std::runtime_error("Failed to start \"" + command + "\"");
+    }
+    // write input in another thread, so the command never blocks writing output while we block writing input
+    int writeError = 0;
+    std::thread writer([&]() {
+        // a command that does not read all input closes the pipe. get EPIPE instead of being killed by SIGPIPE
+        sigset_t signals;
+        sigemptyset(&signals);
+        sigaddset(&signals, SIGPIPE);
+        pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+        for (std::size_t written = 0; written < data.size();)
+        {
+            const auto result = write(inPipe[1], data.data() + written, data.size() - written);
+            if (result < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (result < 0)
+            {
+                writeError = errno;
+                break;
+            }
+            written += static_cast<std::size_t>(result);
+        }
+        close(inPipe[1]);
+    });
+    std::string output;
+    std::array<char, 64 * 1024> buffer{};
+    while (true)
+    {
+        const auto result = read(outPipe[0], buffer.data(), buffer.size());
+        if (result < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (result <= 0)
+        {
+            break;
+        }
+        output.append(buffer.data(), static_cast<std::size_t>(result));
+    }
+    close(outPipe[0]);
+    writer.join();
+    int status = 0;
+    while (waitpid(pid, &status, 0) < 0 && errno == EINTR)
+    {
+    }
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+    {
+        throw std::runtime_error("Command \"" + command + "\" failed with exit code " + std::to_string(WIFEXITED(status) ? WEXITSTATUS(status) : -1));
+    }
+    // commands may stop reading input early, e.g. if they only need the start of the data
+    if (writeError != 0 && writeError != EPIPE)
+    {
+        throw std::runtime_error("Failed to write input of \"" + command + "\": " + std::strerror(writeError));
+    }
+    data.swap(output);
+}
+#endif
+
+Transform createTransform(const std::string &name)
+{
+    static const std::string commandPrefix = "cmd:";
+    if (name == "minify-whitespace")
+    {
+        return {name, minifyWhitespace};
+    }
+    if (name == "trim-zeros")
+    {
+        return {name, trimTrailingZeros};
+    }
+    if (name == "strip-png")
+    {
+        return {name, stripPngMetadata};
+    }
+    if (name.compare(0, commandPrefix.size(), commandPrefix) == 0 && name.size() > commandPrefix.size())
+    {
+        const auto command = name.substr(commandPrefix.size());
+        return {name, [command](std::string &data) { runTransformCommand(command, data); }};
+    }
+    throw std::runtime_error("Unknown transform \"" + name + "\"");
+}
+
+std::string normalizeTransformExtension(const std::string &extension)
+{
+    std::string result = (extension.empty() || extension.front() != '.') ? "." + extension : extension;
+    std::transform(result.begin(), result.end(), result.begin(), [](char c) { return static_cast<char>(std::tolower(static_cast<unsigned char>(c))); });
+    return result;
+}
+
+const std::vector<Transform> *findTransforms(const TransformMap &transforms, const stdfs::path &filePath)
+{
+    if (transforms.empty() || !filePath.has_extension())
+    {
+        return nullptr;
+    }
+    const auto transformIt = transforms.find(normalizeTransformExtension(filePath.extension().string()));
+    return transformIt != transforms.cend() ? &transformIt->second : nullptr;
+}
+
+std::string transformFile(const stdfs::path &filePath, const std::vector<Transform> &transforms)
+{
+    std::ifstream inStream(filePath.string(), std::ios_base::in | std::ios_base::binary);
+    if (!inStream.is_open())
+    {
+        throw std::runtime_error("Failed to open file for reading");
+    }
+    std::ostringstream content;
+    content << inStream.rdbuf();
+    if (inStream.bad())
+    {
+        throw std::runtime_error("Failed to read file");
+    }
+    std::string data = content.str();
+    for (const auto &transform : transforms)
+    {
+        try
+        {
+            transform.apply(data);
+        }
+        catch (const std::runtime_error &e)
+        {
+            throw std::runtime_error("Transform \"" + transform.name + "\" failed: " + e.what());
+        }
+    }
+    return data;
+}
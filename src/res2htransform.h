@@ -0,0 +1,54 @@
+// Transforms applied to the content of input files before res2h converts them or stores them in an archive
+#pragma once
+
+#include "stdfs.h"
+
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+/// @brief Function changing the content of a file in place.
+/// @throw std::runtime_error if the data can't be transformed.
+using TransformFunction = std::function<void(std::string &data)>;
+
+/// @brief Transform with the name it was created from.
+struct Transform
+{
+    std::string name; // !<Name passed to createTransform().
+    TransformFunction apply;
+};
+
+/// @brief Transforms by lower-case file extension including the dot, e.g. ".json". They are applied in list order.
+using TransformMap = std::map<std::string, std::vector<Transform>>;
+
+/// @brief Remove spaces and tabs at the start and end of all lines, carriage returns and empty lines.
+/// Line breaks are kept, so line-based syntax like preprocessor directives in GLSL still works.
+/// Use for JSON, GLSL and other text formats where whitespace at the start and end of a line has no meaning.
+void minifyWhitespace(std::string &data);
+
+/// @brief Remove the run of zero bytes at the end of data, e.g. padding of binary files.
+void trimTrailingZeros(std::string &data);
+
+/// @brief Remove the text, time and EXIF chunks tEXt, zTXt, iTXt, tIME and eXIf from PNG data. Image data and color information are kept.
+/// @throw std::runtime_error if data is not a valid PNG file.
+void stripPngMetadata(std::string &data);
+
+/// @brief Run command using the shell, write data to its stdin and replace data with what the command writes to stdout.
+/// @throw std::runtime_error if the command can't be started or fails. Not supported on Windows.
+void runTransformCommand(const std::string &command, std::string &data);
+
+/// @brief Create transform from its name. Built-in transforms are "minify-whitespace", "trim-zeros" and "strip-png".
+/// Names starting with "cmd:" run the rest of the name as command using runTransformCommand().
+/// @throw std::runtime_error if name is not a valid transform.
+Transform createTransform(const std::string &name);
+
+/// @brief Return extension in lower case with a leading dot, e.g. ".json" for "JSON".
+std::string normalizeTransformExtension(const std::string &extension);
+
+/// @brief Return the transforms for filePath by its extension or nullptr if there are none.
+const std::vector<Transform> *findTransforms(const TransformMap &transforms, const stdfs::path &filePath);
+
+/// @brief Read file and apply transforms to its content in order.
+/// @throw std::runtime_error if the file can't be read or a transform fails.
+std::string transformFile(const stdfs::path &filePath, const std::vector<Transform> &transforms);
@@ -1,7 +1,17 @@
 #include "stdfshelpers.h"
 
+#include <algorithm>
+#include <array>
 #include <fstream>
 
+#if defined(__linux__)
+#include <fcntl.h>
+#include <sys/sendfile.h>
+#include <unistd.h>
+
+#include <cerrno>
+#endif
+
 // This is based on the example code found here: https://svn.boost.org/trac/boost/ticket/1976
 stdfs::path naiveRelative(const stdfs::path &path, const stdfs::path &base)
 {
@@ -98,10 +108,15 @@ bool startsWithPrefix(const stdfs::path &path, const stdfs::path &prefix)
 
 bool hasRecursiveSymlink(const stdfs::path &path)
 {
-    if (stdfs::is_symlink(path))
+    std::error_code error;
+    if (stdfs::is_symlink(path, error))
     {
-        // check if the symlink points somewhere in the path. this would recurse
-        if (startsWithPrefix(stdfs::canonical(path), path))
+        // check if the symlink points somewhere in the path. this would recurse.
+        // compare with the location of the link with all symlinks leading to it resolved, like they are in the target
+        const auto target = stdfs::canonical(path, error);
+        std::error_code parentError;
+        const auto location = stdfs::canonical(path.has_parent_path() ? path.parent_path() : stdfs::current_path(), parentError) / path.filename();
+        if (error || parentError || startsWithPrefix(target, location) || startsWithPrefix(location, target))
         {
             return true;
         }
@@ -127,7 +142,13 @@ void appendFileContent(const stdfs::path &dstFile, const stdfs::path &srcFile)
     {
         throw std::runtime_error("Failed to open source file for reading");
     }
-    // copy data from input to output file
+    // copy as much as possible in the kernel. appending writes at the end, so the buffered copy continues after it
+    const auto dstSize = static_cast<uint64_t>(stdfs::file_size(dstFile));
+    const auto srcSize = static_cast<uint64_t>(stdfs::file_size(srcFile));
+    preallocateFile(dstFile, dstSize + srcSize);
+    const uint64_t copied = copyFileRange(dstFile, dstSize, srcFile, 0, srcSize);
+    inStream.seekg(static_cast<std::streamoff>(copied));
+    // copy remaining data from input to output file
     while (!inStream.eof() && inStream.good())
     {
         std::array<uint8_t, 4096> buffer{};
@@ -159,6 +180,84 @@ void appendFileContent(const stdfs::path &dstFile, const stdfs::path &srcFile)
     }
 }
 
+uint64_t copyFileRange(const stdfs::path &dstFile, uint64_t dstOffset, const stdfs::path &srcFile, uint64_t srcOffset, uint64_t size)
+{
+#if defined(__linux__)
+    const int srcDescriptor = open(srcFile.c_str(), O_RDONLY | O_CLOEXEC);
+    if (srcDescriptor < 0)
+    {
+        return 0;
+    }
+    const int dstDescriptor = open(dstFile.c_str(), O_WRONLY | O_CLOEXEC);
+    if (dstDescriptor < 0)
+    {
+        close(srcDescriptor);
+        return 0;
+    }
+    uint64_t copied = 0;
+    bool useCopyFileRange = true;
+    while (copied < size)
+    {
+        // limit the size per call, so it fits into ssize_t everywhere
+        const auto count = static_cast<std::size_t>(std::min(size - copied, static_cast<uint64_t>(1024 * 1024 * 1024)));
+        ssize_t result = 0;
+        if (useCopyFileRange)
+        {
+            auto inOffset = static_cast<loff_t>(srcOffset + copied);
+            auto outOffset = static_cast<loff_t>(dstOffset + copied);
+            result = copy_file_range(srcDescriptor, &inOffset, dstDescriptor, &outOffset, count, 0);
+        }
+        else
+        {
+            // sendfile() writes at the file position of the destination
+            auto inOffset = static_cast<off_t>(srcOffset + copied);
+            result = lseek(dstDescriptor, static_cast<off_t>(dstOffset + copied), SEEK_SET) < 0 ? -1 : sendfile(dstDescriptor, srcDescriptor, &inOffset, count);
+        }
+        if (result < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        // old kernels, copies between filesystems and some filesystems don't support copy_file_range()
+        if (result < 0 && useCopyFileRange && (errno == ENOSYS || errno == EXDEV || errno == EINVAL || errno == EOPNOTSUPP))
+        {
+            useCopyFileRange = false;
+            continue;
+        }
+        // errors and end of file are reported by the buffered copy of the rest
+        if (result <= 0)
+        {
+            break;
+        }
+        copied += static_cast<uint64_t>(result);
+    }
+    close(dstDescriptor);
+    close(srcDescriptor);
+    return copied;
+#else
+    (void)dstFile;
+    (void)dstOffset;
+    (void)srcFile;
+    (void)srcOffset;
+    (void)size;
+    return 0;
+#endif
+}
+
+void preallocateFile(const stdfs::path &filePath, uint64_t size)
+{
+#if defined(__linux__)
+    const int descriptor = open(filePath.c_str(), O_WRONLY | O_CLOEXEC);
+    if (descriptor >= 0)
+    {
+        (void)fallocate(descriptor, FALLOC_FL_KEEP_SIZE, 0, static_cast<off_t>(size));
+        close(descriptor);
+    }
+#else
+    (void)filePath;
+    (void)size;
+#endif
+}
+
 bool compareFileContent(const stdfs::path &a, const stdfs::path &b)
 {
     // try opening first file.
@@ -226,3 +325,23 @@ bool compareFileContent(const stdfs::path &a, const stdfs::path &b)
     }
     return true;
 }
+
+bool replaceFileIfChanged(const stdfs::path &dstFile, const stdfs::path &srcFile)
+{
+    try
+    {
+        // check if the destination already has the same content
+        if (stdfs::exists(dstFile) && stdfs::file_size(dstFile) == stdfs::file_size(srcFile) && compareFileContent(dstFile, srcFile))
+        {
+            stdfs::remove(srcFile);
+            return false;
+        }
+        // no. rename source to destination. this replaces the destination atomically
+        stdfs::rename(srcFile, dstFile);
+    }
+    catch (const stdfs::filesystem_error &e)
+    {
+        throw std::runtime_error(e.what());
+    }
+    return true;
+}
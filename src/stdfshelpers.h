@@ -19,9 +19,26 @@ bool startsWithPrefix(const stdfs::path &path, const stdfs::path &prefix);
 bool hasRecursiveSymlink(const stdfs::path &path);
 
 /// @brief Appends the content of srcFile to the end of dstFile.
+/// The data is copied in the kernel if supported, see copyFileRange(), else through a buffer.
 /// @throw std::runtime_exception if one of the files can't be opened or reading / writing fails.
 void appendFileContent(const stdfs::path &dstFile, const stdfs::path &srcFile);
 
+/// @brief Copy size bytes at srcOffset in srcFile to dstOffset in the existing file dstFile without passing them through user space.
+/// Uses copy_file_range() or sendfile() on Linux. On reflink-capable filesystems like XFS or btrfs this may only share the data blocks.
+/// @return Returns the number of bytes copied. This is less than size if the files can't be opened, the system does not
+/// support copying these files in the kernel or an error occurred. Copy the rest through a buffer, which reports errors.
+uint64_t copyFileRange(const stdfs::path &dstFile, uint64_t dstOffset, const stdfs::path &srcFile, uint64_t srcOffset, uint64_t size);
+
+/// @brief Reserve disk space for size bytes of the existing file filePath, so writing it does not fragment it. The file size does not change.
+/// This is only a hint. Errors are ignored, e.g. if the filesystem does not support preallocation.
+void preallocateFile(const stdfs::path &filePath, uint64_t size);
+
 /// @brief Compare the content of file a to file b and returns true if the content is binary equal.
 /// @throw std::runtime_exception if one of the files can't be opened or reading fails.
 bool compareFileContent(const stdfs::path &a, const stdfs::path &b);
+
+/// @brief Move srcFile to dstFile, but only if dstFile does not exist or its content differs from srcFile.
+/// Otherwise srcFile is removed and dstFile is left untouched, so its modification time does not change.
+/// @return Returns true if dstFile was replaced, false if it already had the same content.
+/// @throw std::runtime_exception if one of the files can't be read, moved or removed.
+bool replaceFileIfChanged(const stdfs::path &dstFile, const stdfs::path &srcFile);
@@ -4,6 +4,7 @@
 #include <iomanip>
 #include <iostream>
 #include <memory>
+#include <mutex>
 #include <sstream>
 
 bool systemCommand(const std::string &cmd)
@@ -37,8 +38,11 @@ std::pair<bool, std::string> systemCommandStdout(const std::string &cmd)
 
 std::string currentDateAndTime()
 {
+    // std::localtime returns a pointer to shared static data, so guard against concurrent calls
+    static std::mutex localTimeMutex;
     std::stringstream ss;
     std::time_t t = std::time(nullptr);
+    std::lock_guard<std::mutex> lock(localTimeMutex);
     ss << std::put_time(std::localtime(&t), "%F %T");
     return ss.str();
 }
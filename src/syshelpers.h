@@ -10,5 +10,5 @@ bool systemCommand(const std::string &cmd);
 /// @brief Run system command an return result from stdout. Will return <true, ...> if command was sucessfully run.
 std::pair<bool, std::string> systemCommandStdout(const std::string &cmd);
 
-/// @brief Return the current data and time as a string in the format (%F %T).
+/// @brief Return the current data and time as a string in the format (%F %T). Thread-safe.
 std::string currentDateAndTime();
@@ -0,0 +1,287 @@
+// Measure how long compiling res2h output takes and how much memory the compiler needs for different data sizes and output modes
+#include "stdfs.h"
+
+#include <sys/resource.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/// @brief Wall time and peak memory use of a process.
+struct ProcessCost
+{
+    double seconds = 0;
+    uint64_t peakRssKB = 0; // !<Maximum resident set size in KB.
+};
+
+/// @brief Cost of converting and compiling data of one size in one mode.
+struct BenchmarkResult
+{
+    std::string mode;
+    uint64_t size = 0;
+    ProcessCost res2h;
+    ProcessCost compile; // !<Zero if the output is not compiled (ELF objects).
+    uint64_t outputSize = 0; // !<Size of the file res2h generated in bytes.
+};
+
+/// @brief Run a command and measure its cost. The command is executed directly, not using the shell.
+/// @throw std::runtime_error if the command can't be started or fails.
+static ProcessCost runProcess(const std::vector<std::string> &command)
+{
+    std::vector<char *> argv;
+    for (const auto &argument : command)
+    {
+        argv.push_back(const_cast<char *>(argument.c_str()));
+    }
+    argv.push_back(nullptr);
+    const auto start = std::chrono::steady_clock::now();
+    const pid_t pid = fork();
+    if (pid < 0)
+    {
+        throw std::runtime_error("Failed to start \"" + command.front() + "\"");
+    }
+    if (pid == 0)
+    {
+        // child. silence output, so only the results are printed
+        if (freopen("/dev/null", "w", stdout) == nullptr)
+        {
+            _exit(127);
+        }
+        execvp(argv[0], argv.data());
+        _exit(127);
+    }
+    // wait4() returns the resource usage of this child only, not the maximum of all children
+    int status = 0;
+    rusage usage{};
+    if (wait4(pid, &status, 0, &usage) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+    {
+        throw std::runtime_error("Command \"" + command.front() + "\" failed");
+    }
+    ProcessCost cost;
+    cost.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    cost.peakRssKB = static_cast<uint64_t>(usage.ru_maxrss);
+    return cost;
+}
+
+/// @brief Parse a size with an optional K, M or G suffix.
+static uint64_t parseSize(const std::string &text)
+{
+    std::size_t suffixPos = 0;
+    const uint64_t value = std::stoull(text, &suffixPos);
+    const std::string suffix = text.substr(suffixPos);
+    const uint32_t shift = suffix.empty() ? 0 : (suffix == "K" ? 10 : (suffix == "M" ? 20 : (suffix == "G" ? 30 : 64)));
+    if (shift >= 64)
+    {
+        throw std::invalid_argument("Invalid size \"" + text + "\"");
+    }
+    return value << shift;
+}
+
+/// @brief Split a comma-separated list.
+static std::vector<std::string> splitList(const std::string &text)
+{
+    std::vector<std::string> result;
+    std::istringstream stream(text);
+    std::string item;
+    while (std::getline(stream, item, ','))
+    {
+        if (!item.empty())
+        {
+            result.push_back(item);
+        }
+    }
+    return result;
+}
+
+/// @brief Write size bytes of reproducible random data to filePath. All byte values occur, like in compressed assets.
+static void generateData(const stdfs::path &filePath, uint64_t size)
+{
+    std::ofstream outStream(filePath.string(), std::ofstream::out | std::ofstream::binary | std::ofstream::trunc);
+    if (!outStream.is_open())
+    {
+        throw std::runtime_error("Failed to open " + filePath.string() + " for writing");
+    }
+    std::mt19937 mte(12345);
+    std::vector<char> buffer(1024 * 1024);
+    for (uint64_t written = 0; written < size;)
+    {
+        for (auto &c : buffer)
+        {
+            c = static_cast<char>(mte() & 0xFF);
+        }
+        const auto blockSize = std::min(static_cast<uint64_t>(buffer.size()), size - written);
+        outStream.write(buffer.data(), static_cast<std::streamsize>(blockSize));
+        written += blockSize;
+    }
+}
+
+/// @brief Read results of an earlier run written by writeResults().
+static std::map<std::string, BenchmarkResult> readResults(const stdfs::path &filePath)
+{
+    std::ifstream inStream(filePath.string());
+    if (!inStream.is_open())
+    {
+        throw std::runtime_error("Failed to open baseline " + filePath.string());
+    }
+    std::map<std::string, BenchmarkResult> results;
+    std::string line;
+    std::getline(inStream, line); // skip column names
+    while (std::getline(inStream, line))
+    {
+        std::istringstream lineStream(line);
+        BenchmarkResult result;
+        std::string field;
+        std::vector<std::string> fields;
+        while (std::getline(lineStream, field, ','))
+        {
+            fields.push_back(field);
+        }
+        if (fields.size() != 7)
+        {
+            throw std::runtime_error("Invalid baseline line \"" + line + "\"");
+        }
+        result.mode = fields[0];
+        result.size = std::stoull(fields[1]);
+        result.outputSize = std::stoull(fields[2]);
+        result.res2h.seconds = std::stod(fields[3]);
+        result.res2h.peakRssKB = std::stoull(fields[4]);
+        result.compile.seconds = std::stod(fields[5]);
+        result.compile.peakRssKB = std::stoull(fields[6]);
+        results[result.mode + "/" + fields[1]] = result;
+    }
+    return results;
+}
+
+/// @brief Write results as CSV, so they can be tracked over time and used as baseline.
+static void writeResults(const stdfs::path &filePath, const std::vector<BenchmarkResult> &results)
+{
+    std::ofstream outStream(filePath.string(), std::ofstream::out | std::ofstream::trunc);
+    if (!outStream.is_open())
+    {
+        throw std::runtime_error("Failed to open " + filePath.string() + " for writing");
+    }
+    outStream << "mode,size,outputSize,res2hSeconds,res2hPeakRssKB,compileSeconds,compilePeakRssKB" << std::endl;
+    outStream << std::fixed << std::setprecision(6);
+    for (const auto &result : results)
+    {
+        outStream << result.mode << "," << result.size << "," << result.outputSize << "," << result.res2h.seconds << "," << result.res2h.peakRssKB << "," << result.compile.seconds << "," << result.compile.peakRssKB << std::endl;
+    }
+}
+
+static void printUsage()
+{
+    std::cout << "Usage: benchmark_compile --res2h RES2H --cxx CXX --cc CC --out OUTDIR [OPTIONS]" << std::endl;
+    std::cout << "Converts random data of different sizes using res2h and compiles the output." << std::endl;
+    std::cout << "Valid OPTIONS:" << std::endl;
+    std::cout << "--sizes LIST Comma-separated data sizes with optional K, M or G suffix (default 1K,64K,1M,16M,256M)." << std::endl;
+    std::cout << "--modes LIST Comma-separated res2h output modes (default hex,string,elf,asm)." << std::endl;
+    std::cout << "--baseline FILE Fail if compile time or memory exceed the results in FILE, written by an earlier run," << std::endl;
+    std::cout << "   by more than the tolerance factor. Compile times below 0.1s are not compared." << std::endl;
+    std::cout << "--tolerance FACTOR Factor results may exceed the baseline by (default 1.5)." << std::endl;
+}
+
+int main(int argc, const char *argv[])
+{
+    std::map<std::string, std::string> options = {{"--sizes", "1K,64K,1M,16M,256M"}, {"--modes", "hex,string,elf,asm"}, {"--tolerance", "1.5"}};
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        options[argv[i]] = argv[i + 1];
+    }
+    if (argc % 2 != 1 || options["--res2h"].empty() || options["--cxx"].empty() || options["--cc"].empty() || options["--out"].empty())
+    {
+        printUsage();
+        return 2;
+    }
+    const stdfs::path outDir = options["--out"];
+    std::vector<BenchmarkResult> results;
+    try
+    {
+        stdfs::create_directories(outDir);
+        std::cout << std::setw(8) << "Mode" << std::setw(12) << "Size" << std::setw(14) << "Output" << std::setw(12) << "res2h [s]"
+                  << std::setw(14) << "Compile [s]" << std::setw(14) << "Peak RSS [MB]" << std::endl;
+        for (const auto &sizeText : splitList(options["--sizes"]))
+        {
+            const auto size = parseSize(sizeText);
+            const auto dataPath = outDir / ("data_" + sizeText + ".bin");
+            generateData(dataPath, size);
+            for (const auto &mode : splitList(options["--modes"]))
+            {
+                const auto modeDir = outDir / (mode + "_" + sizeText);
+                stdfs::remove_all(modeDir);
+                stdfs::create_directories(modeDir);
+                const std::string extension = mode == "elf" ? ".o" : (mode == "asm" ? ".S" : ".cpp");
+                const auto outPath = modeDir / ("data_" + sizeText + "_bin" + extension);
+                BenchmarkResult result;
+                result.mode = mode;
+                result.size = size;
+                result.res2h = runProcess({options["--res2h"], dataPath.string(), outPath.string(), "-m", mode, "-h", (modeDir / "resources.h").string()});
+                result.outputSize = static_cast<uint64_t>(stdfs::file_size(outPath));
+                // object files need no compiler, assembler files are built by the C compiler driver
+                if (mode != "elf")
+                {
+                    const auto &compiler = mode == "asm" ? options["--cc"] : options["--cxx"];
+                    std::vector<std::string> command = {compiler, "-c", outPath.string(), "-o", (modeDir / "data.o").string(), "-I", modeDir.string()};
+                    if (mode != "asm")
+                    {
+                        command.emplace_back("-std=c++14");
+                    }
+                    result.compile = runProcess(command);
+                }
+                std::cout << std::setw(8) << mode << std::setw(12) << size << std::setw(14) << result.outputSize << std::fixed << std::setprecision(3)
+                          << std::setw(12) << result.res2h.seconds << std::setw(14) << result.compile.seconds
+                          << std::setw(14) << std::setprecision(1) << static_cast<double>(result.compile.peakRssKB) / 1024.0 << std::endl;
+                results.push_back(result);
+                // generated sources of big files are huge. don't keep them around
+                stdfs::remove_all(modeDir);
+            }
+            stdfs::remove(dataPath);
+        }
+        writeResults(outDir / "compile_benchmark.csv", results);
+        std::cout << "Results written to " << (outDir / "compile_benchmark.csv") << std::endl;
+        // compare against an earlier run
+        if (!options["--baseline"].empty())
+        {
+            const auto baseline = readResults(options["--baseline"]);
+            const double tolerance = std::stod(options["--tolerance"]);
+            bool regressed = false;
+            for (const auto &result : results)
+            {
+                const auto baseIt = baseline.find(result.mode + "/" + std::to_string(result.size));
+                if (baseIt == baseline.cend())
+                {
+                    continue;
+                }
+                const auto &base = baseIt->second;
+                const bool slower = result.compile.seconds >= 0.1 && result.compile.seconds > base.compile.seconds * tolerance;
+                const bool bigger = result.compile.peakRssKB > static_cast<uint64_t>(static_cast<double>(base.compile.peakRssKB) * tolerance);
+                if (slower || bigger)
+                {
+                    std::cerr << "Regression in mode " << result.mode << " with " << result.size << " bytes: compiling took " << result.compile.seconds << "s ("
+                              << base.compile.seconds << "s before) and " << result.compile.peakRssKB << "KB (" << base.compile.peakRssKB << "KB before)" << std::endl;
+                    regressed = true;
+                }
+            }
+            if (regressed)
+            {
+                return 1;
+            }
+        }
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "Benchmark failed: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,256 @@
+// Measure the throughput of the res2h generator functions on synthetic input trees
+#include "res2hconvert.h"
+#include "res2hhelpers.h"
+#include "res2hstats.h"
+#include "stdfs.h"
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/// @brief Time spent on one phase of the generator for one input tree.
+struct BenchmarkResult
+{
+    std::string tree;
+    std::string phase;
+    uint64_t nrOfFiles = 0;
+    uint64_t bytes = 0; // !<Number of input bytes the phase processed.
+    double seconds = 0;
+};
+
+/// @brief Parse a size with an optional K, M or G suffix.
+static uint64_t parseSize(const std::string &text)
+{
+    std::size_t suffixPos = 0;
+    const uint64_t value = std::stoull(text, &suffixPos);
+    const std::string suffix = text.substr(suffixPos);
+    const uint32_t shift = suffix.empty() ? 0 : (suffix == "K" ? 10 : (suffix == "M" ? 20 : (suffix == "G" ? 30 : 64)));
+    if (shift >= 64)
+    {
+        throw std::invalid_argument("Invalid size \"" + text + "\"");
+    }
+    return value << shift;
+}
+
+/// @brief Split a comma-separated list.
+static std::vector<std::string> splitList(const std::string &text)
+{
+    std::vector<std::string> result;
+    std::istringstream stream(text);
+    std::string item;
+    while (std::getline(stream, item, ','))
+    {
+        if (!item.empty())
+        {
+            result.push_back(item);
+        }
+    }
+    return result;
+}
+
+/// @brief Write size bytes of reproducible random data to filePath. All byte values occur, like in compressed assets.
+static void generateData(const stdfs::path &filePath, uint64_t size, std::mt19937 &mte)
+{
+    std::ofstream outStream(filePath.string(), std::ofstream::out | std::ofstream::binary | std::ofstream::trunc);
+    if (!outStream.is_open())
+    {
+        throw std::runtime_error("Failed to open " + filePath.string() + " for writing");
+    }
+    std::vector<char> buffer(static_cast<std::size_t>(std::min(size, static_cast<uint64_t>(1024 * 1024))));
+    for (uint64_t written = 0; written < size;)
+    {
+        for (auto &c : buffer)
+        {
+            c = static_cast<char>(mte() & 0xFF);
+        }
+        const auto blockSize = std::min(static_cast<uint64_t>(buffer.size()), size - written);
+        outStream.write(buffer.data(), static_cast<std::streamsize>(blockSize));
+        written += blockSize;
+    }
+}
+
+/// @brief Create nrOfFiles files of 16 to 256 bytes, 100 files per directory.
+static void generateTinyTree(const stdfs::path &treeDir, uint64_t nrOfFiles)
+{
+    std::mt19937 mte(12345);
+    for (uint64_t index = 0; index < nrOfFiles; ++index)
+    {
+        const auto dirPath = treeDir / ("dir" + std::to_string(index / 100));
+        if (index % 100 == 0)
+        {
+            stdfs::create_directories(dirPath);
+        }
+        generateData(dirPath / ("file" + std::to_string(index) + ".bin"), 16 + mte() % 241, mte);
+    }
+}
+
+/// @brief Create nrOfFiles files of fileSize bytes.
+static void generateHugeTree(const stdfs::path &treeDir, uint64_t nrOfFiles, uint64_t fileSize)
+{
+    std::mt19937 mte(12345);
+    stdfs::create_directories(treeDir);
+    for (uint64_t index = 0; index < nrOfFiles; ++index)
+    {
+        generateData(treeDir / ("huge" + std::to_string(index) + ".bin"), fileSize, mte);
+    }
+}
+
+/// @brief Create a chain of depth nested directories holding 4 files of 1K each.
+static void generateDeepTree(const stdfs::path &treeDir, uint64_t depth)
+{
+    std::mt19937 mte(12345);
+    auto dirPath = treeDir;
+    for (uint64_t level = 0; level < depth; ++level)
+    {
+        dirPath /= "level" + std::to_string(level);
+        stdfs::create_directories(dirPath);
+        for (uint32_t index = 0; index < 4; ++index)
+        {
+            generateData(dirPath / ("file" + std::to_string(index) + ".txt"), 1024, mte);
+        }
+    }
+}
+
+/// @brief Run phaseFunction and return a result holding the time it took. Files and bytes are counted afterwards, so phases may fill in files.
+static BenchmarkResult measure(const std::string &tree, const std::string &phase, const std::vector<FileData> &files, const std::function<void()> &phaseFunction)
+{
+    BenchmarkResult result;
+    result.tree = tree;
+    result.phase = phase;
+    const auto start = std::chrono::steady_clock::now();
+    phaseFunction();
+    result.seconds = secondsSince(start);
+    result.nrOfFiles = files.size();
+    for (const auto &file : files)
+    {
+        result.bytes += file.size;
+    }
+    return result;
+}
+
+/// @brief Run all generator phases on the files in treeDir and write the output to outDir.
+static std::vector<BenchmarkResult> runBenchmark(const std::string &tree, const stdfs::path &treeDir, const stdfs::path &outDir, const std::vector<std::string> &modes, uint32_t threadCount)
+{
+    std::vector<BenchmarkResult> results;
+    std::vector<FileData> files;
+    results.push_back(measure(tree, "getFileData", files, [&]() { files = getFileData(treeDir, treeDir, true); }));
+    if (files.empty())
+    {
+        throw std::runtime_error("No files found in " + treeDir.string());
+    }
+    results.push_back(measure(tree, "generateOutputPaths", files, [&]() { generateOutputPaths(files, treeDir, outDir, ".cpp"); }));
+    static const std::map<std::string, OutputMode> modeNames = {{"hex", OutputMode::Hex}, {"string", OutputMode::String}, {"elf", OutputMode::Elf}};
+    for (const auto &mode : modes)
+    {
+        const auto modeIt = modeNames.find(mode);
+        if (modeIt == modeNames.cend())
+        {
+            throw std::invalid_argument("Invalid mode \"" + mode + "\"");
+        }
+        ConvertOptions options;
+        options.outputMode = modeIt->second;
+        results.push_back(measure(tree, "convertFile " + mode, files, [&]() {
+            for (auto &file : files)
+            {
+                std::ofstream outStream;
+                if (!convertFile(file, "", options, outStream))
+                {
+                    throw std::runtime_error("Failed to convert " + file.inPath.string());
+                }
+            }
+        }));
+        // converted sources of big files are huge. don't keep them around
+        for (const auto &file : files)
+        {
+            stdfs::remove(file.outPath);
+        }
+    }
+    // the archive is written sequentially and with reader threads
+    for (const uint32_t threads : {static_cast<uint32_t>(1), threadCount})
+    {
+        Stats statistics;
+        results.push_back(measure(tree, "createBlob -j " + std::to_string(threads), files, [&]() {
+            if (!createBlob(files, outDir / "archive.bin", 0, threads, false, statistics))
+            {
+                throw std::runtime_error("Failed to create archive");
+            }
+        }));
+        stdfs::remove(outDir / "archive.bin");
+    }
+    return results;
+}
+
+static void printResult(const BenchmarkResult &result)
+{
+    const double megaBytes = static_cast<double>(result.bytes) / (1024.0 * 1024.0);
+    const double seconds = result.seconds > 0 ? result.seconds : 1e-9;
+    std::cout << std::setw(6) << result.tree << std::setw(22) << result.phase << std::setw(8) << result.nrOfFiles << std::fixed << std::setprecision(1)
+              << std::setw(10) << megaBytes << std::setprecision(4) << std::setw(10) << result.seconds << std::setprecision(1)
+              << std::setw(10) << megaBytes / seconds << std::setw(12) << static_cast<double>(result.nrOfFiles) / seconds << std::endl;
+}
+
+static void printUsage()
+{
+    std::cout << "Usage: benchmark_generator --out OUTDIR [OPTIONS]" << std::endl;
+    std::cout << "Generates synthetic input trees in OUTDIR and measures the throughput of getFileData(), generateOutputPaths()," << std::endl;
+    std::cout << "convertFile() and createBlob() on them in MB/s and files/s." << std::endl;
+    std::cout << "Valid OPTIONS:" << std::endl;
+    std::cout << "--tiny-files N Number of files of 16 to 256 bytes in the \"tiny\" tree (default 20000)." << std::endl;
+    std::cout << "--huge-files N Number of files in the \"huge\" tree (default 3)." << std::endl;
+    std::cout << "--huge-size SIZE Size of files in the \"huge\" tree with optional K, M or G suffix (default 64M)." << std::endl;
+    std::cout << "--depth N Number of nested directories in the \"deep\" tree, each holding 4 files of 1K (default 64)." << std::endl;
+    std::cout << "--modes LIST Comma-separated output modes convertFile() is measured with (default hex,string,elf)." << std::endl;
+    std::cout << "--threads N Number of threads createBlob() is measured with in addition to 1 thread (default 4)." << std::endl;
+}
+
+int main(int argc, const char *argv[])
+{
+    std::map<std::string, std::string> options = {{"--tiny-files", "20000"}, {"--huge-files", "3"}, {"--huge-size", "64M"}, {"--depth", "64"}, {"--modes", "hex,string,elf"}, {"--threads", "4"}};
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        options[argv[i]] = argv[i + 1];
+    }
+    if (argc % 2 != 1 || options["--out"].empty())
+    {
+        printUsage();
+        return 2;
+    }
+    const stdfs::path outDir = options["--out"];
+    try
+    {
+        const auto modes = splitList(options["--modes"]);
+        const auto threadCount = static_cast<uint32_t>(std::stoul(options["--threads"]));
+        // trees are generated again every run, so their content does not depend on earlier runs
+        stdfs::remove_all(outDir);
+        generateTinyTree(outDir / "tiny", std::stoull(options["--tiny-files"]));
+        generateHugeTree(outDir / "huge", std::stoull(options["--huge-files"]), parseSize(options["--huge-size"]));
+        generateDeepTree(outDir / "deep", std::stoull(options["--depth"]));
+        std::cout << std::setw(6) << "Tree" << std::setw(22) << "Phase" << std::setw(8) << "Files" << std::setw(10) << "MB" << std::setw(10) << "Time [s]"
+                  << std::setw(10) << "MB/s" << std::setw(12) << "Files/s" << std::endl;
+        for (const auto &tree : {"tiny", "huge", "deep"})
+        {
+            const auto treeOutDir = outDir / (std::string(tree) + "_output");
+            stdfs::create_directories(treeOutDir);
+            for (const auto &result : runBenchmark(tree, outDir / tree, treeOutDir, modes, threadCount))
+            {
+                printResult(result);
+            }
+        }
+        stdfs::remove_all(outDir);
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "Benchmark failed: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
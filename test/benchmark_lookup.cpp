@@ -0,0 +1,66 @@
+#include "resources.h"
+#include "test_base.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+// Compare the generated sorted table to the std::map res2h used to generate, which was built at startup
+bool test_lookupbenchmark()
+{
+    using Clock = std::chrono::high_resolution_clock;
+    const uint32_t nrOfRounds = 20;
+    // look up names in random, but reproducable order
+    std::vector<std::string> names;
+    for (uint32_t i = 0; i < res2hNrOfFiles; ++i)
+    {
+        names.emplace_back(res2hFiles[i].relativeFileName);
+    }
+    std::shuffle(names.begin(), names.end(), std::mt19937(12345));
+    // build map like the generated code did during static initialization
+    auto start = Clock::now();
+    std::map<const std::string, const Res2hEntry> res2hMap;
+    for (uint32_t i = 0; i < res2hNrOfFiles; ++i)
+    {
+        res2hMap.emplace(res2hFiles[i].relativeFileName, res2hFiles[i]);
+    }
+    const std::chrono::duration<double, std::micro> mapBuildTime = Clock::now() - start;
+    // look up all names using the map
+    uint64_t mapSum = 0;
+    start = Clock::now();
+    for (uint32_t round = 0; round < nrOfRounds; ++round)
+    {
+        for (const auto &name : names)
+        {
+            mapSum += res2hMap.find(name)->second.size;
+        }
+    }
+    const std::chrono::duration<double, std::nano> mapLookupTime = Clock::now() - start;
+    // look up all names using the table
+    uint64_t tableSum = 0;
+    start = Clock::now();
+    for (uint32_t round = 0; round < nrOfRounds; ++round)
+    {
+        for (const auto &name : names)
+        {
+            tableSum += res2hFind(name.c_str())->size;
+        }
+    }
+    const std::chrono::duration<double, std::nano> tableLookupTime = Clock::now() - start;
+    CHECK_EQUAL(mapSum, tableSum)
+    const double nrOfLookups = static_cast<double>(nrOfRounds) * static_cast<double>(names.size());
+    std::cout << std::endl
+              << res2hNrOfFiles << " entries:" << std::endl;
+    std::cout << "std::map construction at startup: " << mapBuildTime.count() << " us, table: 0 us" << std::endl;
+    std::cout << "std::map lookup: " << mapLookupTime.count() / nrOfLookups << " ns" << std::endl;
+    std::cout << "Table lookup: " << tableLookupTime.count() / nrOfLookups << " ns" << std::endl;
+    TEST_SUCCEEDED
+}
+
+START_SUITE("Res2h lookup benchmark")
+RUN_TEST("Compare lookup times", test_lookupbenchmark())
+END_SUITE
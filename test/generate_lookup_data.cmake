@@ -0,0 +1,9 @@
+# Create NR_OF_FILES small files in OUT_DIR, 100 per subdirectory, for the lookup benchmark
+# Usage: cmake -DOUT_DIR=<dir> -DNR_OF_FILES=<count> -P generate_lookup_data.cmake
+
+file(REMOVE_RECURSE ${OUT_DIR})
+math(EXPR LAST_FILE "${NR_OF_FILES} - 1")
+foreach(index RANGE ${LAST_FILE})
+	math(EXPR subdir "${index} / 100")
+	file(WRITE ${OUT_DIR}/dir${subdir}/file${index}.txt "${index}")
+endforeach()
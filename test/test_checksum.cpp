@@ -5,6 +5,8 @@
 #include <algorithm>
 #include <array>
 #include <random>
+#include <string>
+#include <vector>
 
 static bool test_fletcher_zero()
 {
@@ -60,9 +62,85 @@ static bool test_fletcher_sameresult()
     TEST_SUCCEEDED
 }
 
+template <typename T>
+static bool test_fletcher_stream_type(const std::vector<uint8_t> &data)
+{
+    std::mt19937 mte(12345);
+    // blocks of any size must give the same result as all data at once
+    FletcherStream<T> stream;
+    for (std::size_t offset = 0; offset < data.size();)
+    {
+        const auto blockSize = std::min(static_cast<std::size_t>(mte() % 11), data.size() - offset);
+        stream.update(data.data() + offset, blockSize);
+        offset += blockSize;
+    }
+    CHECK_EQUAL(stream.checksum(), calculateFletcher<T>(data.data(), static_cast<T>(data.size())))
+    // prefixes of any size can be added before or after the rest of the data
+    for (std::size_t prefixSize = 0; prefixSize < 9; ++prefixSize)
+    {
+        FletcherStream<T> before(prefixSize);
+        before.addPrefix(data.data(), prefixSize);
+        before.update(data.data() + prefixSize, data.size() - prefixSize);
+        CHECK_EQUAL(before.checksum(), calculateFletcher<T>(data.data(), static_cast<T>(data.size())))
+        FletcherStream<T> after(prefixSize);
+        after.update(data.data() + prefixSize, data.size() - prefixSize);
+        after.addPrefix(data.data(), prefixSize);
+        CHECK_EQUAL(after.checksum(), calculateFletcher<T>(data.data(), static_cast<T>(data.size())))
+    }
+    // blocks checksummed on their own can be added in any order and more data can follow
+    for (std::size_t blockSize = 1; blockSize < 10; ++blockSize)
+    {
+        std::vector<FletcherStream<T>> blocks;
+        for (std::size_t offset = 0; offset + blockSize <= data.size() - 7; offset += blockSize)
+        {
+            blocks.emplace_back(offset);
+            blocks.back().update(data.data() + offset, blockSize);
+        }
+        std::shuffle(blocks.begin(), blocks.end(), mte);
+        FletcherStream<T> combined;
+        for (const auto &block : blocks)
+        {
+            combined.add(block);
+        }
+        const auto end = (data.size() - 7) / blockSize * blockSize;
+        CHECK_EQUAL(combined.checksum(), calculateFletcher<T>(data.data(), static_cast<T>(end)))
+        combined.update(data.data() + end, data.size() - end);
+        CHECK_EQUAL(combined.checksum(), calculateFletcher<T>(data.data(), static_cast<T>(data.size())))
+    }
+    // a prefix without data following it
+    FletcherStream<T> prefixOnly(5);
+    prefixOnly.addPrefix(data.data(), 5);
+    CHECK_EQUAL(prefixOnly.checksum(), calculateFletcher<T>(data.data(), 5))
+    TEST_SUCCEEDED
+}
+
+static bool test_fletcher_stream()
+{
+    std::vector<uint8_t> data(1001);
+    std::mt19937 mte(12345);
+    std::generate(data.begin(), data.end(), [&]() { return static_cast<uint8_t>(mte() & 0xFF); });
+    CHECK(test_fletcher_stream_type<uint32_t>(data))
+    CHECK(test_fletcher_stream_type<uint64_t>(data))
+    TEST_SUCCEEDED
+}
+
+static bool test_fnv1a64_result()
+{
+    const std::string data = "foobar";
+    CHECK_EQUAL(calculateFNV1a64(reinterpret_cast<const uint8_t *>(data.data()), 0), FNV1A64_OFFSET_BASIS)
+    CHECK_EQUAL(calculateFNV1a64(reinterpret_cast<const uint8_t *>(data.data()), 1), 0xaf63db4c8601ead9ULL)
+    CHECK_EQUAL(calculateFNV1a64(reinterpret_cast<const uint8_t *>(data.data()), data.size()), 0x85944171f73967e8ULL)
+    // hashing in blocks must give the same result
+    const auto first = calculateFNV1a64(reinterpret_cast<const uint8_t *>(data.data()), 2);
+    CHECK_EQUAL(calculateFNV1a64(reinterpret_cast<const uint8_t *>(data.data()) + 2, data.size() - 2, first), 0x85944171f73967e8ULL)
+    TEST_SUCCEEDED
+}
+
 START_SUITE("Checksum functions")
 RUN_TEST("Fletcher results", test_fletcher_result())
 RUN_TEST("Fletcher all zeros", test_fletcher_zero())
 RUN_TEST("Fletcher different lengths", test_fletcher_difflengths())
 RUN_TEST("Fletcher gives consistent results", test_fletcher_sameresult())
+RUN_TEST("Fletcher in blocks", test_fletcher_stream())
+RUN_TEST("FNV-1a results", test_fnv1a64_result())
 END_SUITE
@@ -2,6 +2,11 @@
 
 #include "stdfshelpers.h"
 
+#include <chrono>
+#include <fstream>
+#include <iterator>
+#include <string>
+
 static bool test_naiverelative()
 {
     CHECK_EQUAL(naiveRelative("/foo/bar/new.file", "/foo/bar/"),  stdfs::path("new.file"))
@@ -38,6 +43,25 @@ static bool test_startsWithPrefix()
     TEST_SUCCEEDED
 }
 
+static bool test_hasrecursivesymlink()
+{
+    // real/data/sub/link points to real/data, an ancestor of the link. symdir points to real
+    const stdfs::path baseDir = stdfs::path("/tmp") / "recursive_symlink";
+    stdfs::remove_all(baseDir);
+    stdfs::create_directories(baseDir / "real" / "data" / "sub");
+    stdfs::create_directory_symlink("../", baseDir / "real" / "data" / "sub" / "link");
+    stdfs::create_directory_symlink(baseDir / "real", baseDir / "symdir");
+    CHECK(!hasRecursiveSymlink(baseDir / "real" / "data" / "sub"))
+    CHECK(hasRecursiveSymlink(baseDir / "real" / "data" / "sub" / "link"))
+    // the loop must also be found if the path to the link goes through another symlink
+    CHECK(!hasRecursiveSymlink(baseDir / "symdir"))
+    CHECK(hasRecursiveSymlink(baseDir / "symdir" / "data" / "sub" / "link"))
+    // links that can't be resolved are treated as recursive
+    stdfs::create_directory_symlink(baseDir / "not.there", baseDir / "dangling");
+    CHECK(hasRecursiveSymlink(baseDir / "dangling"))
+    TEST_SUCCEEDED
+}
+
 static bool test_comparefilecontent(const stdfs::path &dataDir)
 {
     CHECK(compareFileContent(dataDir / "test1.png", dataDir / "test1.png"))
@@ -56,12 +80,61 @@ static bool test_appendfilecontent(const stdfs::path &dataDir)
     TEST_SUCCEEDED
 }
 
+static bool test_copyfilerange(const stdfs::path &dataDir)
+{
+    // copy the middle of test1.png into the middle of a file of the same size. systems without kernel copies copy nothing
+    const auto size = static_cast<uint64_t>(stdfs::file_size(dataDir / "test1.png"));
+    std::ofstream("/tmp/copyrange.bin", std::ofstream::binary | std::ofstream::trunc) << std::string(static_cast<std::size_t>(size), 'x');
+    const uint64_t copied = copyFileRange("/tmp/copyrange.bin", 100, dataDir / "test1.png", 200, size - 300);
+    CHECK(copied <= size - 300)
+    std::ifstream sourceStream((dataDir / "test1.png").string(), std::ios_base::in | std::ios_base::binary);
+    const std::string source((std::istreambuf_iterator<char>(sourceStream)), std::istreambuf_iterator<char>());
+    std::ifstream copyStream("/tmp/copyrange.bin", std::ios_base::in | std::ios_base::binary);
+    const std::string copy((std::istreambuf_iterator<char>(copyStream)), std::istreambuf_iterator<char>());
+    CHECK_EQUAL(copy.size(), source.size())
+    CHECK(copy.substr(0, 100) == std::string(100, 'x'))
+    CHECK(copy.substr(100, static_cast<std::size_t>(copied)) == source.substr(200, static_cast<std::size_t>(copied)))
+    CHECK(copy.substr(static_cast<std::size_t>(100 + copied)) == std::string(static_cast<std::size_t>(size - 100 - copied), 'x'))
+    // missing files copy nothing
+    CHECK_EQUAL(copyFileRange("/tmp/copyrange.bin", 0, dataDir / "not.there", 0, 10), 0)
+    // preallocation does not change the file size
+    preallocateFile("/tmp/copyrange.bin", 1024 * 1024);
+    CHECK_EQUAL(stdfs::file_size("/tmp/copyrange.bin"), size)
+    TEST_SUCCEEDED
+}
+
+static bool test_replacefileifchanged(const stdfs::path &dataDir)
+{
+    // destination does not exist
+    stdfs::remove("/tmp/replace_dst.txt");
+    CHECK(stdfs::copy_file(dataDir / "a.txt", "/tmp/replace_src.txt", stdfs::copy_options::overwrite_existing))
+    CHECK(replaceFileIfChanged("/tmp/replace_dst.txt", "/tmp/replace_src.txt"))
+    CHECK(!stdfs::exists("/tmp/replace_src.txt"))
+    CHECK(compareFileContent("/tmp/replace_dst.txt", dataDir / "a.txt"))
+    // destination has same content. it must not be touched
+    const auto oldTime = stdfs::last_write_time("/tmp/replace_dst.txt") - std::chrono::hours(1);
+    stdfs::last_write_time("/tmp/replace_dst.txt", oldTime);
+    CHECK(stdfs::copy_file(dataDir / "a.txt", "/tmp/replace_src.txt", stdfs::copy_options::overwrite_existing))
+    CHECK(!replaceFileIfChanged("/tmp/replace_dst.txt", "/tmp/replace_src.txt"))
+    CHECK(!stdfs::exists("/tmp/replace_src.txt"))
+    CHECK(stdfs::last_write_time("/tmp/replace_dst.txt") == oldTime)
+    // destination has different content
+    CHECK(stdfs::copy_file(dataDir / "b.txt", "/tmp/replace_src.txt", stdfs::copy_options::overwrite_existing))
+    CHECK(replaceFileIfChanged("/tmp/replace_dst.txt", "/tmp/replace_src.txt"))
+    CHECK(compareFileContent("/tmp/replace_dst.txt", dataDir / "b.txt"))
+    CHECK_THROW(replaceFileIfChanged("/tmp/replace_dst.txt", "/tmp/replace_src.txt"), std::runtime_error)
+    TEST_SUCCEEDED
+}
+
 START_SUITE("File system helper functions")
 stdfs::path buildDir = stdfs::current_path();
 stdfs::path dataDir = buildDir / "../../test/data";
 RUN_TEST("Check naiveRelative", test_naiverelative())
 RUN_TEST("Check naiveLexicallyNormal", test_naivelexicallynormal())
 RUN_TEST("Check startsWithPrefix", test_startsWithPrefix())
+RUN_TEST("Check hasRecursiveSymlink", test_hasrecursivesymlink())
 RUN_TEST("Check compareFileContent", test_comparefilecontent(dataDir))
 RUN_TEST("Check appendFileContent", test_appendfilecontent(dataDir))
+RUN_TEST("Check copyFileRange", test_copyfilerange(dataDir))
+RUN_TEST("Check replaceFileIfChanged", test_replacefileifchanged(dataDir))
 END_SUITE
@@ -0,0 +1,25 @@
+#include "resources.h"
+#include "stdfs.h"
+#include "test_base.h"
+
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+// Check that the data of a.txt is still there. All other resources are unused and removed by the linker
+bool test_useddata(const stdfs::path &filePath)
+{
+    std::ifstream inStream(filePath.string(), std::ios_base::in | std::ios_base::binary);
+    CHECK(inStream.is_open())
+    const std::vector<char> fileData((std::istreambuf_iterator<char>(inStream)), std::istreambuf_iterator<char>());
+    CHECK_EQUAL(a_txt_size, fileData.size())
+    CHECK(std::equal(fileData.cbegin(), fileData.cend(), reinterpret_cast<const char *>(a_txt_data)))
+    TEST_SUCCEEDED
+}
+
+START_SUITE("Res2h section garbage collection test")
+stdfs::path buildDir = stdfs::current_path();
+RUN_TEST("Check used data", test_useddata(buildDir / "../../test/data/a.txt"))
+END_SUITE
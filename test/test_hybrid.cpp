@@ -0,0 +1,49 @@
+#include "res2hinterface.h"
+#include "resources.h"
+#include "stdfs.h"
+#include "test_base.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+// Check that res2hGetData() returns the content of a file, no matter if it is embedded or in the archive
+static bool checkData(const stdfs::path &filePath, const std::string &relativeFileName, bool archived)
+{
+    const auto entry = res2hFind(relativeFileName);
+    CHECK(entry != nullptr)
+    CHECK_EQUAL(entry->data == nullptr, archived)
+    std::ifstream inStream(filePath.string(), std::ios_base::in | std::ios_base::binary);
+    CHECK(inStream.is_open())
+    const std::vector<char> fileData((std::istreambuf_iterator<char>(inStream)), std::istreambuf_iterator<char>());
+    uint64_t size = 0;
+    const auto data = res2hGetData(entry, &size);
+    CHECK(data != nullptr)
+    CHECK_EQUAL(size, fileData.size())
+    CHECK(std::equal(fileData.cbegin(), fileData.cend(), reinterpret_cast<const char *>(data)))
+    // embedded data is not copied and archived data is cached
+    CHECK(archived ? res2hGetData(entry, nullptr) == data : data == entry->data)
+    return true;
+}
+
+// Files bigger than 4K were stored in the archive appended to this executable
+bool test_hybriddata(const stdfs::path &dataDir)
+{
+    CHECK(Res2h::instance().loadArchive("/proc/self/exe"))
+    CHECK_EQUAL(res2hNrOfFiles, 8)
+    for (const auto &fileName : {"a.txt", "ab.txt", "b.txt", "subdir/a.txt", "subdir/subdir2/test3.txt", "test2.txt"})
+    {
+        CHECK(checkData(dataDir / fileName, std::string(":/") + fileName, false))
+    }
+    CHECK(checkData(dataDir / "test1.png", ":/test1.png", true))
+    CHECK(checkData(dataDir / "subdir/test2.jpg", ":/subdir/test2.jpg", true))
+    TEST_SUCCEEDED
+}
+
+START_SUITE("Res2h hybrid output test")
+stdfs::path buildDir = stdfs::current_path();
+RUN_TEST("Check embedded and archived data", test_hybriddata(buildDir / "../../test/data/"))
+END_SUITE
@@ -0,0 +1,89 @@
+#include "checksum.h"
+#include "resources.h"
+#include "stdfs.h"
+#include "test_base.h"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+// Check that the table is sorted and all files can be found
+bool test_find(const stdfs::path &dataDir)
+{
+    CHECK_EQUAL(res2hNrOfFiles, 8)
+    for (uint32_t i = 0; i < res2hNrOfFiles; ++i)
+    {
+        const auto &entry = res2hFiles[i];
+        if (i > 0)
+        {
+            CHECK(strcmp(res2hFiles[i - 1].relativeFileName, entry.relativeFileName) < 0)
+        }
+        CHECK(res2hFind(entry.relativeFileName) == &entry)
+#ifndef TEST_C_MODE
+        CHECK(res2hFind(std::string(entry.relativeFileName)) == &entry)
+#endif
+        // remove ":/" from the internal name to get the path on disk
+        const auto filePath = dataDir / std::string(entry.relativeFileName).substr(2);
+        std::ifstream inStream(filePath.string(), std::ios_base::in | std::ios_base::binary);
+        CHECK(inStream.is_open())
+        const std::vector<char> fileData((std::istreambuf_iterator<char>(inStream)), std::istreambuf_iterator<char>());
+        CHECK_EQUAL(entry.size, fileData.size())
+#ifdef TEST_COMPRESS
+        // data is decompressed on first use and cached
+        uint64_t size = 0;
+        const uint8_t *data = res2hGetData(&entry, &size);
+        CHECK(data != nullptr)
+        CHECK_EQUAL(size, entry.size)
+        CHECK(res2hGetData(&entry, nullptr) == data)
+#else
+        const uint8_t *data = entry.data;
+#endif
+        CHECK(std::equal(fileData.cbegin(), fileData.cend(), reinterpret_cast<const char *>(data)))
+#ifdef TEST_ALIGNMENT
+        CHECK_EQUAL(reinterpret_cast<uintptr_t>(data) % TEST_ALIGNMENT, 0)
+#endif
+    }
+#ifdef TEST_DEDUP
+    // files with the same content share their data
+    CHECK(res2hFind(":/a.txt")->data == res2hFind(":/subdir/a.txt")->data)
+#else
+    CHECK(res2hFind(":/a.txt")->data != res2hFind(":/subdir/a.txt")->data)
+#endif
+    CHECK(res2hFind(":/not/there.txt") == nullptr)
+    CHECK(res2hFind("") == nullptr)
+    CHECK(res2hFind(":/a.txtx") == nullptr)
+    TEST_SUCCEEDED
+}
+
+// Check that resources can be accessed by ID and by the hash of their name
+bool test_ids()
+{
+    CHECK(res2hGet(res2hId_a_txt) == res2hFind(":/a.txt"))
+    CHECK(res2hGet(res2hId_subdir_subdir2_test3_txt) == res2hFind(":/subdir/subdir2/test3.txt"))
+    CHECK(res2hGet(res2hId_test2_txt) == &res2hFiles[res2hNrOfFiles - 1])
+    for (uint32_t i = 0; i < res2hNrOfFiles; ++i)
+    {
+        const auto &entry = res2hFiles[i];
+        CHECK(res2hGet(static_cast<Res2hId>(i)) == &entry)
+        const auto hash = calculateFNV1a64(reinterpret_cast<const uint8_t *>(entry.relativeFileName), strlen(entry.relativeFileName));
+        CHECK(res2hFindHash(hash) == &entry)
+    }
+    CHECK(res2hFindHash(0) == nullptr)
+#ifndef TEST_C_MODE
+    // hashes are computed at compile time
+    static_assert(res2hHash(":/subdir/test2.jpg") == res2hHash_subdir_test2_jpg, "Hash constant differs from hash function");
+    static_assert(res2hHash("") == FNV1A64_OFFSET_BASIS, "Hash of empty name differs from FNV-1a offset basis");
+    CHECK(res2hFindHash(res2hHash_test1_png) == res2hFind(":/test1.png"))
+    CHECK(res2hFindHash(res2hHash(":/b.txt")) == res2hGet(res2hId_b_txt))
+#endif
+    TEST_SUCCEEDED
+}
+
+START_SUITE("Res2h lookup test")
+stdfs::path buildDir = stdfs::current_path();
+RUN_TEST("Check finding files", test_find(buildDir / "../../test/data/"))
+RUN_TEST("Check resource IDs", test_ids())
+END_SUITE
@@ -0,0 +1,105 @@
+#include "test_base.h"
+
+#include "lz4.h"
+
+#include <algorithm>
+#include <array>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Compress and decompress data and check that the result matches
+static bool roundtrip(const std::vector<uint8_t> &data)
+{
+    const auto compressed = compressLZ4(data.data(), data.size());
+    if (compressed.size() > data.size() + data.size() / 255 + 16)
+    {
+        return false;
+    }
+    return decompressLZ4(compressed.data(), compressed.size(), data.size()) == data;
+}
+
+static bool test_lz4_small()
+{
+    // empty data is stored as a single token
+    CHECK_EQUAL(compressLZ4(nullptr, 0).size(), 1)
+    CHECK(roundtrip({}))
+    CHECK(roundtrip({42}))
+    CHECK(roundtrip({1, 2, 3, 4, 1, 2, 3, 4, 1, 2, 3, 4}))
+    CHECK(roundtrip({1, 2, 3, 4, 1, 2, 3, 4, 1, 2, 3, 4, 1}))
+    TEST_SUCCEEDED
+}
+
+static bool test_lz4_known()
+{
+    // 32 'a's are one literal, an overlapping match of length 26 and 5 literals
+    const std::string data(32, 'a');
+    const std::vector<uint8_t> expected = {0x1F, 'a', 0x01, 0x00, 0x07, 0x50, 'a', 'a', 'a', 'a', 'a'};
+    CHECK(compressLZ4(reinterpret_cast<const uint8_t *>(data.data()), data.size()) == expected)
+    const auto decompressed = decompressLZ4(expected.data(), expected.size(), data.size());
+    CHECK(std::equal(decompressed.cbegin(), decompressed.cend(), data.cbegin()))
+    TEST_SUCCEEDED
+}
+
+static bool test_lz4_patterns()
+{
+    std::mt19937 mte(1234);
+    std::uniform_int_distribution<uint16_t> dist(0, 255);
+    // random data does not compress
+    std::vector<uint8_t> random(100000);
+    std::generate(random.begin(), random.end(), [&]() { return static_cast<uint8_t>(dist(mte)); });
+    CHECK(roundtrip(random))
+    // long runs need extra length bytes
+    std::vector<uint8_t> runs(100000, 7);
+    std::fill(runs.begin() + 50000, runs.end(), 8);
+    CHECK(roundtrip(runs))
+    CHECK(compressLZ4(runs.data(), runs.size()).size() < 1000)
+    // text with repetitions further away than the maximum offset
+    std::vector<uint8_t> text;
+    for (uint32_t i = 0; i < 20000; ++i)
+    {
+        const std::string word = "word" + std::to_string(dist(mte)) + " ";
+        text.insert(text.end(), word.cbegin(), word.cend());
+    }
+    CHECK(roundtrip(text))
+    CHECK(compressLZ4(text.data(), text.size()).size() < text.size() / 2)
+    TEST_SUCCEEDED
+}
+
+static bool test_lz4_files(const std::string &dataDir)
+{
+    for (const auto &fileName : {"a.txt", "test1.png", "subdir/test2.jpg", "subdir/subdir2/test3.txt"})
+    {
+        std::ifstream inStream(dataDir + fileName, std::ios_base::in | std::ios_base::binary);
+        CHECK(inStream.is_open())
+        const std::vector<uint8_t> data((std::istreambuf_iterator<char>(inStream)), std::istreambuf_iterator<char>());
+        CHECK(roundtrip(data))
+    }
+    TEST_SUCCEEDED
+}
+
+static bool test_lz4_invalid()
+{
+    // match offset before start of data
+    const std::array<uint8_t, 4> badOffset = {0x10, 'a', 0x02, 0x00};
+    CHECK_THROW(decompressLZ4(badOffset.data(), badOffset.size(), 10), std::runtime_error)
+    // literals past the end of the input
+    const std::array<uint8_t, 2> truncated = {0x50, 'a'};
+    CHECK_THROW(decompressLZ4(truncated.data(), truncated.size(), 5), std::runtime_error)
+    // output bigger than expected
+    const std::array<uint8_t, 3> tooBig = {0x20, 'a', 'b'};
+    CHECK_THROW(decompressLZ4(tooBig.data(), tooBig.size(), 1), std::runtime_error)
+    CHECK_THROW(decompressLZ4(tooBig.data(), tooBig.size(), 3), std::runtime_error)
+    TEST_SUCCEEDED
+}
+
+START_SUITE("LZ4 compression")
+RUN_TEST("Small inputs", test_lz4_small())
+RUN_TEST("Known result", test_lz4_known())
+RUN_TEST("Data patterns", test_lz4_patterns())
+RUN_TEST("Test data files", test_lz4_files("../../test/data/"))
+RUN_TEST("Invalid data", test_lz4_invalid())
+END_SUITE
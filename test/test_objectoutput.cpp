@@ -0,0 +1,35 @@
+#include "resources.h"
+#include "stdfs.h"
+#include "test_base.h"
+
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+// Check that the data linked into this executable matches the files in dataDir
+bool test_linkeddata(const stdfs::path &dataDir)
+{
+    CHECK_EQUAL(res2hNrOfFiles, 8)
+    for (uint32_t i = 0; i < res2hNrOfFiles; ++i)
+    {
+        const auto &entry = res2hFiles[i];
+        // remove ":/" from the internal name to get the path on disk
+        const auto filePath = dataDir / std::string(entry.relativeFileName).substr(2);
+        std::ifstream inStream(filePath.string(), std::ios_base::in | std::ios_base::binary);
+        CHECK(inStream.is_open())
+        const std::vector<char> fileData((std::istreambuf_iterator<char>(inStream)), std::istreambuf_iterator<char>());
+        CHECK_EQUAL(entry.size, fileData.size())
+        CHECK(std::equal(fileData.cbegin(), fileData.cend(), reinterpret_cast<const char *>(entry.data)))
+#ifdef TEST_ALIGNMENT
+        CHECK_EQUAL(reinterpret_cast<uintptr_t>(entry.data) % TEST_ALIGNMENT, 0)
+#endif
+    }
+    TEST_SUCCEEDED
+}
+
+START_SUITE("Res2h object output test")
+stdfs::path buildDir = stdfs::current_path();
+RUN_TEST("Check linked data", test_linkeddata(buildDir / "../../test/data/"))
+END_SUITE
@@ -0,0 +1,56 @@
+#include "res2hregistry.h"
+#include "stdfs.h"
+#include "test_base.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+// Check that a registered resource exists and matches the file it was converted from
+static bool checkEntry(const stdfs::path &filePath, const char *relativeFileName)
+{
+    const auto entry = res2hRegistryFind(relativeFileName);
+    CHECK(entry != nullptr)
+    std::ifstream inStream(filePath.string(), std::ios_base::in | std::ios_base::binary);
+    CHECK(inStream.is_open())
+    const std::vector<char> fileData((std::istreambuf_iterator<char>(inStream)), std::istreambuf_iterator<char>());
+    CHECK_EQUAL(entry->size, fileData.size())
+    CHECK(std::equal(fileData.cbegin(), fileData.cend(), reinterpret_cast<const char *>(entry->data)))
+    return true;
+}
+
+// Resources from the directory and the single file were converted by separate res2h runs and found at link time
+bool test_registeredfiles(const stdfs::path &dataDir)
+{
+    CHECK_EQUAL(res2hRegistryCount(), 9)
+    for (const auto &fileName : {"a.txt", "ab.txt", "b.txt", "subdir/a.txt", "subdir/test2.jpg", "subdir/subdir2/test3.txt", "test1.png", "test2.txt"})
+    {
+        CHECK(checkEntry(dataDir / fileName, (std::string(":/") + fileName).c_str()))
+    }
+    CHECK(checkEntry(dataDir / "test1.png", "test1.png"))
+    TEST_SUCCEEDED
+}
+
+bool test_registryindex()
+{
+    // entries are sorted by name
+    for (uint32_t index = 1; index < res2hRegistryCount(); ++index)
+    {
+        CHECK(std::strcmp(res2hRegistryEntry(index - 1)->relativeFileName, res2hRegistryEntry(index)->relativeFileName) < 0)
+    }
+    CHECK(res2hRegistryEntry(res2hRegistryCount()) == nullptr)
+    CHECK(res2hRegistryFind(":/missing.txt") == nullptr)
+    CHECK(res2hRegistryFind(":/") == nullptr)
+    CHECK(res2hRegistryFind(nullptr) == nullptr)
+    TEST_SUCCEEDED
+}
+
+START_SUITE("Res2h link-time registration test")
+stdfs::path buildDir = stdfs::current_path();
+RUN_TEST("Check registered files", test_registeredfiles(buildDir / "../../test/data/"))
+RUN_TEST("Check registry index", test_registryindex())
+END_SUITE
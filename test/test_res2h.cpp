@@ -1,31 +1,39 @@
 #include "checksum.h"
 #include "res2h.h"
 #include "res2hhelpers.h"
+#include "res2hinterface.h"
 #include "stdfshelpers.h"
 #include "syshelpers.h"
 #include "test_base.h"
 
+#include <algorithm>
+#include <chrono>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <iterator>
+#include <random>
 #include <sstream>
 #include <string>
+#include <thread>
 #include <vector>
 
-bool test_roundtrip(stdfs::path dataDir, const stdfs::path &buildDir)
-{
+// paths of the executables relative to the build directory the tests run in
 #ifdef WIN32
 #ifdef _DEBUG
-    const stdfs::path res2hPath = "..\\Debug\\res2h.exe";
-    const stdfs::path res2hdumpPath = "..\\Debug\\res2hdump.exe";
+static const stdfs::path res2hPath = "..\\Debug\\res2h.exe";
+static const stdfs::path res2hdumpPath = "..\\Debug\\res2hdump.exe";
 #else
-    const stdfs::path res2hPath = "..\\Release\\res2h.exe";
-    const stdfs::path res2hdumpPath = "..\\Release\\res2hdump.exe";
+static const stdfs::path res2hPath = "..\\Release\\res2h.exe";
+static const stdfs::path res2hdumpPath = "..\\Release\\res2hdump.exe";
 #endif
 #else
-    const stdfs::path res2hPath = "../src/res2h";
-    const stdfs::path res2hdumpPath = "../src/res2hdump";
+static const stdfs::path res2hPath = "../src/res2h";
+static const stdfs::path res2hdumpPath = "../src/res2hdump";
 #endif
+
+bool test_roundtrip(stdfs::path dataDir, const stdfs::path &buildDir)
+{
     static const std::string res2hdumpOptions = "-v -f"; // dump using full paths
     static const std::string res2hOptions = "-v -r -b"; // recurse and build binary archive
 
@@ -108,7 +116,351 @@ bool test_roundtrip(stdfs::path dataDir, const stdfs::path &buildDir)
     return true;
 }
 
+bool test_parallelconversion(const stdfs::path &dataDir, const stdfs::path &buildDir)
+{
+    const stdfs::path serialDir = stdfs::path("/tmp") / "out_serial";
+    const stdfs::path parallelDir = stdfs::path("/tmp") / "out_parallel";
+    std::cout << "Converting all files from " << dataDir << " using 1 and 4 threads and comparing results." << std::endl;
+    for (const auto &outDir : {serialDir, parallelDir})
+    {
+        stdfs::remove_all(outDir);
+        stdfs::create_directory(outDir);
+        std::stringstream command;
+        command << (buildDir / res2hPath) << " " << dataDir << " " << outDir << " -r -h " << (outDir / "resources.h") << " -u " << (outDir / "resources.cpp") << (outDir == serialDir ? " -j 1" : " -j 4");
+        if (!systemCommand(command.str()))
+        {
+            std::cout << "The call \"" << command.str() << "\" failed!" << std::endl;
+            return false;
+        }
+    }
+    // check that both runs generated the same files with the same content
+    uint32_t nrOfFiles = 0;
+    for (stdfs::directory_iterator fileIt(serialDir); fileIt != stdfs::directory_iterator(); ++fileIt)
+    {
+        const auto parallelPath = parallelDir / fileIt->path().filename();
+        CHECK(stdfs::exists(parallelPath))
+        CHECK(compareFileContent(fileIt->path(), parallelPath))
+        ++nrOfFiles;
+    }
+    CHECK_EQUAL(nrOfFiles, 10)
+    return true;
+}
+
+bool test_parallelarchive(const stdfs::path &dataDir, const stdfs::path &buildDir)
+{
+    const stdfs::path inDir = stdfs::path("/tmp") / "in_parallelarchive";
+    const stdfs::path outDir = stdfs::path("/tmp") / "out_parallelarchive";
+    std::cout << "Building archives from all files in " << dataDir << " using 1 and 4 threads and comparing results." << std::endl;
+    stdfs::remove_all(inDir);
+    stdfs::remove_all(outDir);
+    stdfs::copy(dataDir, inDir, stdfs::copy_options::recursive);
+    stdfs::create_directory(outDir);
+    // add a file that is split into several blocks with an odd size, so blocks end in the middle of checksum words
+    std::mt19937 mte(4711);
+    std::string bigData(3 * 1024 * 1024 + 512 * 1024 + 3, '\0');
+    std::generate(bigData.begin(), bigData.end(), [&mte]() { return static_cast<char>(mte() & 0xFF); });
+    std::ofstream(inDir / "big.bin", std::ofstream::binary) << bigData;
+    for (const auto threads : {"1", "4"})
+    {
+        std::stringstream command;
+        command << (buildDir / res2hPath) << " " << inDir << " " << (outDir / (std::string("archive") + threads + ".bin")) << " -r -b -j " << threads;
+        CHECK(systemCommand(command.str()))
+    }
+    CHECK(compareFileContent(outDir / "archive1.bin", outDir / "archive4.bin"))
+    // archiveInfo() checks the archive checksum. the archive is not loaded, so later tests don't see its resources
+    const auto archive = Res2h::instance().archiveInfo((outDir / "archive4.bin").string());
+    CHECK_EQUAL(archive.size, stdfs::file_size(outDir / "archive4.bin"))
+    std::ifstream archiveStream((outDir / "archive4.bin").string(), std::ios_base::in | std::ios_base::binary);
+    const std::string archiveData((std::istreambuf_iterator<char>(archiveStream)), std::istreambuf_iterator<char>());
+    CHECK(archiveData.find(bigData) != std::string::npos)
+    return true;
+}
+
+bool test_incrementalconversion(const stdfs::path &dataDir, const stdfs::path &buildDir)
+{
+    const stdfs::path inDir = stdfs::path("/tmp") / "in_incremental";
+    const stdfs::path outDir = stdfs::path("/tmp") / "out_incremental";
+    std::cout << "Converting all files from " << dataDir << " twice and checking that unchanged outputs are not written again." << std::endl;
+    // copy input files, so we can modify them
+    stdfs::remove_all(inDir);
+    stdfs::remove_all(outDir);
+    stdfs::copy(dataDir, inDir, stdfs::copy_options::recursive);
+    stdfs::create_directory(outDir);
+    std::stringstream command;
+    command << (buildDir / res2hPath) << " " << inDir << " " << outDir << " -r -h " << (outDir / "resources.h") << " -u " << (outDir / "resources.cpp") << " --manifest " << (outDir / "manifest.txt");
+    CHECK(systemCommand(command.str()))
+    CHECK(stdfs::exists(outDir / "manifest.txt"))
+    // move the modification time of all outputs into the past
+    const auto oldTime = stdfs::last_write_time(outDir / "resources.h") - std::chrono::hours(1);
+    for (stdfs::directory_iterator fileIt(outDir); fileIt != stdfs::directory_iterator(); ++fileIt)
+    {
+        stdfs::last_write_time(fileIt->path(), oldTime);
+    }
+    // nothing changed, so no output must be written
+    CHECK(systemCommand(command.str()))
+    for (stdfs::directory_iterator fileIt(outDir); fileIt != stdfs::directory_iterator(); ++fileIt)
+    {
+        CHECK(stdfs::last_write_time(fileIt->path()) == oldTime)
+    }
+    // change one input file. only its output, the utilities holding its size and the manifest must be written
+    std::ofstream(inDir / "test2.txt", std::ofstream::app) << "more text";
+    CHECK(systemCommand(command.str()))
+    for (stdfs::directory_iterator fileIt(outDir); fileIt != stdfs::directory_iterator(); ++fileIt)
+    {
+        const auto fileName = fileIt->path().filename();
+        const bool mustChange = fileName == "test2_txt.cpp" || fileName == "resources.cpp" || fileName == "manifest.txt";
+        CHECK_EQUAL(stdfs::last_write_time(fileIt->path()) != oldTime, mustChange)
+    }
+    return true;
+}
+
+bool test_depfile(const stdfs::path &dataDir, const stdfs::path &buildDir)
+{
+    const stdfs::path outDir = stdfs::path("/tmp") / "out_depfile";
+    std::cout << "Writing header and utilities for all files from " << dataDir << " and checking the depfile." << std::endl;
+    stdfs::remove_all(outDir);
+    stdfs::create_directory(outDir);
+    std::stringstream command;
+    command << (buildDir / res2hPath) << " " << dataDir << " " << outDir << " -r -h " << (outDir / "resources.h") << " -u " << (outDir / "resources.cpp") << " --no-data --depfile " << (outDir / "resources.d");
+    CHECK(systemCommand(command.str()))
+    // only header, utilities and depfile must have been written
+    uint32_t nrOfFiles = 0;
+    for (stdfs::directory_iterator fileIt(outDir); fileIt != stdfs::directory_iterator(); ++fileIt)
+    {
+        ++nrOfFiles;
+    }
+    CHECK_EQUAL(nrOfFiles, 3)
+    // the target is the header, followed by all directories and files
+    std::ifstream inStream((outDir / "resources.d").string());
+    CHECK(inStream.is_open())
+    std::string line;
+    CHECK(std::getline(inStream, line))
+    CHECK_EQUAL(line, (outDir / "resources.h").generic_string() + ": \\")
+    std::vector<std::string> dependencies;
+    while (std::getline(inStream, line))
+    {
+        // remove indentation and line continuation
+        const auto start = line.find_first_not_of(' ');
+        const auto end = line.size() > 2 && line.compare(line.size() - 2, 2, " \\") == 0 ? line.size() - 2 : line.size();
+        dependencies.push_back(line.substr(start, end - start));
+    }
+    CHECK_EQUAL(dependencies.size(), 3 + 8)
+    for (const auto &dependency : {"", "subdir", "subdir/subdir2", "a.txt", "subdir/subdir2/test3.txt", "test1.png"})
+    {
+        const auto path = naiveLexicallyNormal(dataDir / dependency);
+        CHECK(std::find(dependencies.cbegin(), dependencies.cend(), path.generic_string()) != dependencies.cend())
+    }
+    return true;
+}
+
+bool test_scan(const stdfs::path &dataDir)
+{
+    std::cout << "Scanning " << dataDir << " with one and multiple threads." << std::endl;
+    std::vector<stdfs::path> serialDirectories;
+    const auto serialFiles = getFileData(dataDir, dataDir, true, false, 1, &serialDirectories);
+    CHECK_EQUAL(serialFiles.size(), 8)
+    CHECK_EQUAL(serialDirectories.size(), 3)
+    CHECK(std::is_sorted(serialFiles.cbegin(), serialFiles.cend(), [](const FileData &a, const FileData &b) { return a.inPath < b.inPath; }))
+    // the result must not depend on the number of threads
+    for (uint32_t nrOfThreads = 2; nrOfThreads <= 8; nrOfThreads *= 2)
+    {
+        std::vector<stdfs::path> directories;
+        const auto files = getFileData(dataDir, dataDir, true, false, nrOfThreads, &directories);
+        CHECK(directories == serialDirectories)
+        CHECK_EQUAL(files.size(), serialFiles.size())
+        for (std::size_t i = 0; i < files.size(); ++i)
+        {
+            CHECK(files[i].inPath == serialFiles[i].inPath)
+            CHECK_EQUAL(files[i].internalName, serialFiles[i].internalName)
+            CHECK_EQUAL(files[i].size, serialFiles[i].size)
+        }
+    }
+    // without recursion only the top level directory is scanned
+    std::vector<stdfs::path> directories;
+    const auto files = getFileData(dataDir, dataDir, false, false, 4, &directories);
+    CHECK_EQUAL(files.size(), 5)
+    CHECK_EQUAL(directories.size(), 1)
+#ifndef WIN32
+    // a link to an ancestor directory must be skipped, also when the input directory is reached through a symlink
+    const stdfs::path baseDir = stdfs::path("/tmp") / "scan_symlink";
+    stdfs::remove_all(baseDir);
+    stdfs::create_directories(baseDir / "real" / "data" / "sub");
+    std::ofstream(baseDir / "real" / "data" / "sub" / "a.txt") << "a";
+    stdfs::create_directory_symlink("../", baseDir / "real" / "data" / "sub" / "link");
+    stdfs::create_directory_symlink(baseDir / "real", baseDir / "symdir");
+    // entries whose status can't be read, like this link to itself, are skipped
+    stdfs::create_symlink("loop", baseDir / "real" / "data" / "loop");
+    for (const auto &inDir : {baseDir / "real" / "data", baseDir / "symdir" / "data"})
+    {
+        const auto linkedFiles = getFileData(inDir, inDir, true, false, 4);
+        CHECK_EQUAL(linkedFiles.size(), 1)
+        CHECK_EQUAL(linkedFiles.front().internalName, ":/sub/a.txt")
+    }
+#endif
+    return true;
+}
+
+bool test_streaminput(const stdfs::path &dataDir, const stdfs::path &buildDir)
+{
+#ifdef WIN32
+    std::cout << "Skipping stream input test on Windows." << std::endl;
+    return true;
+#else
+    const stdfs::path outDir = stdfs::path("/tmp") / "out_stream";
+    const stdfs::path inFile = dataDir / "test1.png";
+    std::cout << "Piping " << inFile << " to res2h through stdin and a FIFO and checking the archives." << std::endl;
+    stdfs::remove_all(outDir);
+    stdfs::create_directory(outDir);
+    std::stringstream command;
+    command << "cat " << inFile << " | " << (buildDir / res2hPath) << " - " << (outDir / "stdin.bin") << " -b";
+    CHECK(systemCommand(command.str()))
+    std::stringstream().swap(command);
+    command << "mkfifo " << (outDir / "fifo") << " && (cat " << inFile << " > " << (outDir / "fifo") << " &) && " << (buildDir / res2hPath) << " " << (outDir / "fifo") << " " << (outDir / "fifo.bin") << " -b";
+    CHECK(systemCommand(command.str()))
+    // the size of streams is unknown when writing the directory, so the archive is always 64 bit
+    const auto fileChecksum = calculateFletcher<uint64_t>(inFile.string());
+    for (const auto &archivePath : {outDir / "stdin.bin", outDir / "fifo.bin"})
+    {
+        const auto archive = Res2h::instance().archiveInfo(archivePath.string());
+        CHECK_EQUAL(archive.bits, 64)
+        CHECK(Res2h::instance().loadArchive(archivePath.string()))
+    }
+    uint32_t nrOfResources = 0;
+    for (const auto &resource : Res2h::instance().resourceInfo())
+    {
+        CHECK_EQUAL(resource.get().dataSize, stdfs::file_size(inFile))
+        CHECK_EQUAL(resource.get().checksum, fileChecksum)
+        ++nrOfResources;
+    }
+    CHECK_EQUAL(nrOfResources, 2)
+    return true;
+#endif
+}
+
+/// @brief Call condition every 10ms until it returns true or 10s have passed.
+template <typename CONDITION>
+static bool waitFor(CONDITION condition)
+{
+    const auto end = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (!condition())
+    {
+        if (std::chrono::steady_clock::now() > end)
+        {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return true;
+}
+
+/// @brief Return the content of a file or an empty string if it can't be read.
+static std::string readText(const stdfs::path &filePath)
+{
+    std::ifstream inStream(filePath.string());
+    std::stringstream content;
+    content << inStream.rdbuf();
+    return content.str();
+}
+
+bool test_watch(const stdfs::path &dataDir, const stdfs::path &buildDir)
+{
+#ifndef __linux__
+    std::cout << "Skipping watch mode test. It is only supported on Linux." << std::endl;
+    return true;
+#else
+    const stdfs::path inDir = stdfs::path("/tmp") / "in_watch";
+    const stdfs::path outDir = stdfs::path("/tmp") / "out_watch";
+    const stdfs::path logFile = stdfs::path("/tmp") / "watch.log";
+    std::cout << "Watching a copy of " << dataDir << " and checking outputs are updated when files change." << std::endl;
+    stdfs::remove_all(inDir);
+    stdfs::remove_all(outDir);
+    stdfs::copy(dataDir, inDir, stdfs::copy_options::recursive);
+    stdfs::create_directory(outDir);
+    // run res2h in the background and get its process ID
+    std::stringstream command;
+    command << (buildDir / res2hPath) << " " << inDir << " " << outDir << " -r -h " << (outDir / "resources.h") << " -u " << (outDir / "resources.cpp") << " --watch > " << logFile << " 2>&1 & echo $!";
+    const auto result = systemCommandStdout(command.str());
+    CHECK(result.first)
+    const auto processId = std::stoul(result.second);
+    // stop watching when returning, also if a check fails
+    struct ProcessGuard
+    {
+        unsigned long processId;
+        ~ProcessGuard() { systemCommand("kill " + std::to_string(processId) + " 2> /dev/null"); }
+    } processGuard{processId};
+    CHECK(waitFor([&]() { return readText(logFile).find("Watching 3 directories") != std::string::npos; }))
+    // change a file. only its output and the utilities holding its size must change
+    const auto oldTime = stdfs::last_write_time(outDir / "resources.h") - std::chrono::hours(1);
+    for (stdfs::directory_iterator fileIt(outDir); fileIt != stdfs::directory_iterator(); ++fileIt)
+    {
+        stdfs::last_write_time(fileIt->path(), oldTime);
+    }
+    std::ofstream(inDir / "test2.txt", std::ofstream::app) << "more text";
+    CHECK(waitFor([&]() { return readText(outDir / "test2_txt.cpp").find("test2_txt_size = 600;") != std::string::npos; }))
+    CHECK(waitFor([&]() { return readText(logFile).find("Converted 1 of 8 files") != std::string::npos; }))
+    for (stdfs::directory_iterator fileIt(outDir); fileIt != stdfs::directory_iterator(); ++fileIt)
+    {
+        const auto fileName = fileIt->path().filename();
+        const bool mustChange = fileName == "test2_txt.cpp" || fileName == "resources.cpp";
+        CHECK_EQUAL(stdfs::last_write_time(fileIt->path()) != oldTime, mustChange)
+    }
+    // add a file in a new directory and remove a file
+    stdfs::create_directory(inDir / "new");
+    std::ofstream(inDir / "new" / "c.txt") << "c";
+    stdfs::remove(inDir / "a.txt");
+    CHECK(waitFor([&]() { return stdfs::exists(outDir / "new__c_txt.cpp") && !stdfs::exists(outDir / "a_txt.cpp"); }))
+    CHECK(waitFor([&]() { return readText(outDir / "resources.cpp").find(":/new/c.txt") != std::string::npos && readText(outDir / "resources.cpp").find(":/a.txt") == std::string::npos; }))
+    // files in the new directory must be watched too
+    std::ofstream(inDir / "new" / "c.txt", std::ofstream::app) << "c";
+    CHECK(waitFor([&]() { return readText(outDir / "new__c_txt.cpp").find("new__c_txt_size = 2;") != std::string::npos; }))
+    // stop watching
+    CHECK(systemCommand("kill " + std::to_string(processId)))
+    CHECK(waitFor([&]() { return readText(logFile).find("Stopped watching") != std::string::npos; }))
+    return true;
+#endif
+}
+
+bool test_transforms(const stdfs::path &dataDir, const stdfs::path &buildDir)
+{
+#ifdef WIN32
+    std::cout << "Skipping transform test on Windows." << std::endl;
+    return true;
+#else
+    const stdfs::path outDir = stdfs::path("/tmp") / "out_transform";
+    std::cout << "Packing all files from " << dataDir << " with transforms and checking the archive contains the transformed data." << std::endl;
+    stdfs::remove_all(outDir);
+    stdfs::create_directory(outDir);
+    std::stringstream command;
+    command << (buildDir / res2hPath) << " " << dataDir << " " << (outDir / "transformed.bin") << " -r -b --transform png strip-png --transform .TXT \"cmd:tr a-z A-Z\"";
+    CHECK(systemCommand(command.str()))
+    CHECK(Res2h::instance().loadArchive((outDir / "transformed.bin").string()))
+    // sizes and checksums stored must be those of the transformed data. loadResource() checks the checksum
+    const auto png = Res2h::instance().loadResource(":/test1.png");
+    CHECK_EQUAL(png.dataSize, stdfs::file_size(dataDir / "test1.png") - 38)
+    const auto text = Res2h::instance().loadResource(":/test2.txt");
+    std::ifstream inStream((dataDir / "test2.txt").string(), std::ios_base::in | std::ios_base::binary);
+    std::string expected((std::istreambuf_iterator<char>(inStream)), std::istreambuf_iterator<char>());
+    std::transform(expected.begin(), expected.end(), expected.begin(), [](char c) { return (c >= 'a' && c <= 'z') ? static_cast<char>(c - 'a' + 'A') : c; });
+    CHECK_EQUAL(std::string(text.data.cbegin(), text.data.cend()), expected)
+    // files without transforms are stored as they are
+    CHECK_EQUAL(Res2h::instance().loadResource(":/subdir/test2.jpg").dataSize, stdfs::file_size(dataDir / "subdir" / "test2.jpg"))
+    // a failing transform must fail the run
+    std::stringstream().swap(command);
+    command << (buildDir / res2hPath) << " " << dataDir << " " << (outDir / "failed.bin") << " -r -b --transform txt \"cmd:exit 1\"";
+    CHECK(!systemCommand(command.str()))
+    return true;
+#endif
+}
+
 START_SUITE("Res2h pack/unpack test")
 stdfs::path buildDir = stdfs::current_path();
 RUN_TEST("Check res2h roundtrip", test_roundtrip(buildDir / "../../test/data/", buildDir))
+RUN_TEST("Check parallel conversion", test_parallelconversion(buildDir / "../../test/data/", buildDir))
+RUN_TEST("Check parallel archive", test_parallelarchive(buildDir / "../../test/data/", buildDir))
+RUN_TEST("Check incremental conversion", test_incrementalconversion(buildDir / "../../test/data/", buildDir))
+RUN_TEST("Check directory scan", test_scan(buildDir / "../../test/data/"))
+RUN_TEST("Check stream input", test_streaminput(buildDir / "../../test/data/", buildDir))
+RUN_TEST("Check depfile", test_depfile(buildDir / "../../test/data/", buildDir))
+RUN_TEST("Check transforms", test_transforms(buildDir / "../../test/data/", buildDir))
+RUN_TEST("Check watch mode", test_watch(buildDir / "../../test/data/", buildDir))
 END_SUITE
@@ -8,6 +8,7 @@
 #include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <iterator>
 #include <sstream>
 #include <string>
 #include <vector>
@@ -76,7 +77,87 @@ bool test_archivecontent(const stdfs::path &dataDir, const stdfs::path &buildDir
     return true;
 }
 
+// Pack files with aligned entry data and check offsets, format flags and content
+bool test_alignedarchive(const stdfs::path &dataDir, const stdfs::path &buildDir)
+{
+    const stdfs::path outFile = stdfs::path("/tmp") / "test_aligned.bin";
+    const stdfs::path parallelFile = stdfs::path("/tmp") / "test_aligned_parallel.bin";
+    std::stringstream command;
+    command << (buildDir / "../src/res2h") << " " << dataDir << " " << outFile << " -r -b --align 4096";
+    CHECK(systemCommand(command.str()))
+    // the padding must not depend on the number of threads writing the archive
+    std::stringstream().swap(command);
+    command << (buildDir / "../src/res2h") << " " << dataDir << " " << parallelFile << " -r -b --align 4096 -j 4";
+    CHECK(systemCommand(command.str()))
+    std::ifstream outStream(outFile.string(), std::ios_base::in | std::ios_base::binary);
+    std::ifstream parallelStream(parallelFile.string(), std::ios_base::in | std::ios_base::binary);
+    const std::string archiveData((std::istreambuf_iterator<char>(outStream)), std::istreambuf_iterator<char>());
+    CHECK(archiveData == std::string((std::istreambuf_iterator<char>(parallelStream)), std::istreambuf_iterator<char>()))
+    // use a copy, so the resources don't end up in the instance other tests use
+    auto res2h = Res2h::instance();
+    const auto archive = res2h.archiveInfo(outFile.string());
+    CHECK_EQUAL(archive.bits, 32)
+    CHECK_EQUAL(archive.formatFlags, 32 | (12 << 8))
+    CHECK_EQUAL(archive.dataAlignment, 4096)
+    CHECK_EQUAL(archive.size, archiveData.size())
+    CHECK(res2h.loadArchive(outFile.string()))
+    uint32_t nrOfResources = 0;
+    for (const auto &resource : res2h.resourceInfo())
+    {
+        CHECK_EQUAL(resource.get().dataOffset % 4096, 0)
+        // loading checks the checksum of the resource
+        const auto loaded = res2h.loadResource(resource.get().filePath);
+        std::ifstream inStream((dataDir / resource.get().filePath.substr(2)).string(), std::ios_base::in | std::ios_base::binary);
+        const std::vector<char> fileData((std::istreambuf_iterator<char>(inStream)), std::istreambuf_iterator<char>());
+        CHECK(std::equal(fileData.cbegin(), fileData.cend(), loaded.data.cbegin(), loaded.data.cend(), [](char a, uint8_t b) { return static_cast<uint8_t>(a) == b; }))
+        ++nrOfResources;
+    }
+    CHECK_EQUAL(nrOfResources, 8)
+    // archives can't be aligned when they are appended to other files
+    std::stringstream().swap(command);
+    command << (buildDir / "../src/res2h") << " " << outFile << " " << parallelFile << " -a --align 4096";
+    CHECK(!systemCommand(command.str()))
+    TEST_SUCCEEDED
+}
+
+// Write the resource ID header along with the archive and load resources by ID
+bool test_resourceids(const stdfs::path &dataDir, const stdfs::path &buildDir)
+{
+    const stdfs::path outFile = stdfs::path("/tmp") / "test_ids.bin";
+    const stdfs::path headerFile = stdfs::path("/tmp") / "test_ids.h";
+    std::stringstream command;
+    command << (buildDir / "../src/res2h") << " " << dataDir << " " << outFile << " -r -b -h " << headerFile;
+    CHECK(systemCommand(command.str()))
+    // the header holds the hash of every name
+    std::ifstream headerStream(headerFile.string());
+    CHECK(headerStream.is_open())
+    const std::string header((std::istreambuf_iterator<char>(headerStream)), std::istreambuf_iterator<char>());
+    std::stringstream expected;
+    expected << "constexpr uint64_t res2hHash_subdir_test2_jpg = 0x" << std::hex << std::setw(16) << std::setfill('0') << Res2h::resourceId(":/subdir/test2.jpg") << "ULL;";
+    CHECK(header.find(expected.str()) != std::string::npos)
+    // IDs are hashes of the names and can be computed at compile time
+    static_assert(Res2h::resourceId("") == FNV1A64_OFFSET_BASIS, "Hash of empty name differs from FNV-1a offset basis");
+    const std::string name = ":/test1.png";
+    CHECK_EQUAL(Res2h::resourceId(name.c_str()), calculateFNV1a64(reinterpret_cast<const uint8_t *>(name.data()), name.size()))
+    auto &res2h = Res2h::instance();
+    CHECK(res2h.loadArchive(outFile.string()))
+    for (const auto &fileName : {"a.txt", "subdir/a.txt", "subdir/test2.jpg", "test1.png"})
+    {
+        const auto filePath = ":/" + std::string(fileName);
+        const auto resource = res2h.loadResource(Res2h::resourceId(filePath.c_str()));
+        CHECK_EQUAL(resource.filePath, filePath)
+        CHECK(resource.data == res2h.loadResource(filePath).data)
+        std::ifstream inStream((dataDir / fileName).string(), std::ios_base::in | std::ios_base::binary);
+        const std::vector<char> fileData((std::istreambuf_iterator<char>(inStream)), std::istreambuf_iterator<char>());
+        CHECK(std::equal(fileData.cbegin(), fileData.cend(), resource.data.cbegin(), resource.data.cend(), [](char a, uint8_t b) { return static_cast<uint8_t>(a) == b; }))
+    }
+    CHECK_THROW(res2h.loadResource(Res2h::resourceId(":/not/there.txt")), Res2hException)
+    TEST_SUCCEEDED
+}
+
 START_SUITE("Res2hinterface test")
 stdfs::path buildDir = stdfs::current_path();
 RUN_TEST("Check archive content", test_archivecontent(buildDir / "../../test/data/", buildDir))
+RUN_TEST("Check aligned archive", test_alignedarchive(buildDir / "../../test/data/", buildDir))
+RUN_TEST("Check resource IDs", test_resourceids(buildDir / "../../test/data/", buildDir))
 END_SUITE
@@ -0,0 +1,51 @@
+#include "resources.h"
+#include "stdfs.h"
+#include "test_base.h"
+
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+// Check that the data linked into this executable matches the files in dataDir
+bool test_shardeddata(const stdfs::path &dataDir)
+{
+    CHECK_EQUAL(res2hNrOfFiles, 8)
+    uint32_t nrOfSplitFiles = 0;
+    for (uint32_t i = 0; i < res2hNrOfFiles; ++i)
+    {
+        const auto &entry = res2hFiles[i];
+        // remove ":/" from the internal name to get the path on disk
+        const auto filePath = dataDir / std::string(entry.relativeFileName).substr(2);
+        std::ifstream inStream(filePath.string(), std::ios_base::in | std::ios_base::binary);
+        CHECK(inStream.is_open())
+        const std::vector<char> fileData((std::istreambuf_iterator<char>(inStream)), std::istreambuf_iterator<char>());
+        CHECK_EQUAL(entry.size, fileData.size())
+        // split files have no data pointer, but segments
+        std::vector<char> linkedData;
+        if (entry.data != nullptr)
+        {
+            CHECK_EQUAL(entry.nrOfSegments, 0)
+            linkedData.assign(entry.data, entry.data + entry.size);
+        }
+        else
+        {
+            CHECK(entry.nrOfSegments > 1)
+            for (uint32_t segment = 0; segment < entry.nrOfSegments; ++segment)
+            {
+                CHECK(entry.segments[segment].size <= 4096)
+                linkedData.insert(linkedData.end(), entry.segments[segment].data, entry.segments[segment].data + entry.segments[segment].size);
+            }
+            ++nrOfSplitFiles;
+        }
+        CHECK(linkedData == fileData)
+    }
+    CHECK_EQUAL(nrOfSplitFiles, 2)
+    TEST_SUCCEEDED
+}
+
+START_SUITE("Res2h sharded output test")
+stdfs::path buildDir = stdfs::current_path();
+RUN_TEST("Check sharded data", test_shardeddata(buildDir / "../../test/data/"))
+END_SUITE
@@ -0,0 +1,78 @@
+#include "test_base.h"
+
+#include "res2hstats.h"
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+static bool test_stats_slowest()
+{
+    const std::vector<StatsEntry> files = {{"a", 0.5, 10}, {"b", 2.0, 20}, {"c", 0.5, 30}, {"d", 1.0, 40}};
+    const auto slowest = slowestEntries(files, 3);
+    CHECK_EQUAL(slowest.size(), 3)
+    CHECK_EQUAL(slowest[0].name, "b")
+    CHECK_EQUAL(slowest[1].name, "d")
+    // entries with the same time keep their order
+    CHECK_EQUAL(slowest[2].name, "a")
+    CHECK_EQUAL(slowestEntries(files, 10).size(), 4)
+    CHECK(slowestEntries({}, 10).empty())
+    TEST_SUCCEEDED
+}
+
+static bool test_stats_throughput()
+{
+    CHECK_FLOAT_EQUAL(megabytesPerSecond({"a", 2.0, 4000000}), 2.0, 1e-9)
+    // no measurable time or no data means no throughput
+    CHECK_FLOAT_EQUAL(megabytesPerSecond({"a", 0.0, 4000000}), 0.0, 1e-9)
+    CHECK_FLOAT_EQUAL(megabytesPerSecond({"a", 1.0, 0}), 0.0, 1e-9)
+    TEST_SUCCEEDED
+}
+
+static bool test_stats_print()
+{
+    Stats stats;
+    stats.phases = {{"scan", 0.25, 1000000}, {"header", 0.125, 0}};
+    stats.files = {{"small.txt", 0.125, 100}, {"big.bin", 0.5, 1000000}};
+    std::ostringstream outStream;
+    printStats(outStream, stats, 1);
+    const auto text = outStream.str();
+    CHECK(text.find("0.250000         1000000         4.0  scan") != std::string::npos)
+    CHECK(text.find("0.125000               -           -  header") != std::string::npos)
+    CHECK(text.find("Slowest 1 of 2 files:") != std::string::npos)
+    CHECK(text.find("big.bin") != std::string::npos)
+    CHECK(text.find("small.txt") == std::string::npos)
+    TEST_SUCCEEDED
+}
+
+static bool test_stats_json()
+{
+    Stats stats;
+    stats.phases = {{"convert", 0.5, 2000000}};
+    stats.files = {{"dir\\\"quoted\"\n.txt", 0.25, 3}};
+    std::ostringstream outStream;
+    writeStatsJson(outStream, stats, 10);
+    const std::string expected = "{\n"
+                                 "  \"phases\": [\n"
+                                 "    {\"name\": \"convert\", \"seconds\": 0.500000, \"bytes\": 2000000, \"mbPerSecond\": 4.000000}\n"
+                                 "  ],\n"
+                                 "  \"nrOfFiles\": 1,\n"
+                                 "  \"slowestFiles\": [\n"
+                                 "    {\"name\": \"dir\\\\\\\"quoted\\\"\\u000a.txt\", \"seconds\": 0.250000, \"bytes\": 3, \"mbPerSecond\": 0.000012}\n"
+                                 "  ]\n"
+                                 "}\n";
+    CHECK_EQUAL(outStream.str(), expected)
+    // empty lists are written as empty arrays
+    std::ostringstream emptyStream;
+    writeStatsJson(emptyStream, Stats(), 10);
+    CHECK(emptyStream.str().find("\"phases\": [],") != std::string::npos)
+    CHECK(emptyStream.str().find("\"slowestFiles\": []") != std::string::npos)
+    TEST_SUCCEEDED
+}
+
+START_SUITE("Generator statistics")
+RUN_TEST("Slowest entries", test_stats_slowest())
+RUN_TEST("Throughput", test_stats_throughput())
+RUN_TEST("Printed table", test_stats_print())
+RUN_TEST("JSON output", test_stats_json())
+END_SUITE
@@ -0,0 +1,34 @@
+#include "stream_jpg.h"
+#include "stream_png.h"
+#include "stdfs.h"
+#include "test_base.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+// Check that data converted from stdin matches the file piped to res2h
+static bool checkData(const stdfs::path &filePath, const uint8_t *data, uint64_t size)
+{
+    std::ifstream inStream(filePath.string(), std::ios_base::in | std::ios_base::binary);
+    CHECK(inStream.is_open())
+    const std::vector<char> fileData((std::istreambuf_iterator<char>(inStream)), std::istreambuf_iterator<char>());
+    CHECK_EQUAL(size, fileData.size())
+    CHECK(std::equal(fileData.cbegin(), fileData.cend(), reinterpret_cast<const char *>(data)))
+    return true;
+}
+
+bool test_streamdata(const stdfs::path &dataDir)
+{
+    CHECK(checkData(dataDir / "test1.png", stream_png_data, stream_png_size))
+    CHECK(checkData(dataDir / "subdir/test2.jpg", stream_jpg_data, stream_jpg_size))
+    TEST_SUCCEEDED
+}
+
+START_SUITE("Res2h stream input test")
+stdfs::path buildDir = stdfs::current_path();
+RUN_TEST("Check data read from stdin", test_streamdata(buildDir / "../../test/data/"))
+END_SUITE
@@ -0,0 +1,113 @@
+#include "test_base.h"
+
+#include "res2htransform.h"
+
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+static bool test_transform_whitespace()
+{
+    std::string data = "{\r\n    \"a\": 1,\r\n\r\n\t\"b\" : [1, 2]  \r\n}";
+    minifyWhitespace(data);
+    CHECK_EQUAL(data, "{\n\"a\": 1,\n\"b\" : [1, 2]\n}")
+    // line breaks are kept, so preprocessor directives still work
+    data = "  #version 330\n   \n  void main() {}\n";
+    minifyWhitespace(data);
+    CHECK_EQUAL(data, "#version 330\nvoid main() {}\n")
+    data = " \n\t\n";
+    minifyWhitespace(data);
+    CHECK(data.empty())
+    TEST_SUCCEEDED
+}
+
+static bool test_transform_zeros()
+{
+    std::string data("ab\0c\0\0\0", 7);
+    trimTrailingZeros(data);
+    CHECK_EQUAL(data, std::string("ab\0c", 4))
+    data = std::string(5, '\0');
+    trimTrailingZeros(data);
+    CHECK(data.empty())
+    TEST_SUCCEEDED
+}
+
+static bool test_transform_png(const stdfs::path &dataDir)
+{
+    std::ifstream inStream((dataDir / "test1.png").string(), std::ios_base::in | std::ios_base::binary);
+    CHECK(inStream.is_open())
+    std::ostringstream content;
+    content << inStream.rdbuf();
+    const auto original = content.str();
+    // test1.png has a 26 byte tEXt chunk, which is removed with its length, type and CRC
+    auto data = original;
+    stripPngMetadata(data);
+    CHECK_EQUAL(data.size(), original.size() - 38)
+    CHECK(data.find("tEXt") == std::string::npos)
+    CHECK(data.find("IDAT") != std::string::npos)
+    CHECK_EQUAL(data.substr(data.size() - 8, 4), "IEND")
+    // stripping again changes nothing
+    auto stripped = data;
+    stripPngMetadata(stripped);
+    CHECK(stripped == data)
+    // invalid data must be rejected
+    std::string text = "no png";
+    CHECK_THROW(stripPngMetadata(text), std::runtime_error)
+    auto truncated = original.substr(0, 100);
+    CHECK_THROW(stripPngMetadata(truncated), std::runtime_error)
+    TEST_SUCCEEDED
+}
+
+static bool test_transform_command()
+{
+#ifdef _WIN32
+    std::cout << "Skipping transform command test on Windows." << std::endl;
+#else
+    // more data than fits into a pipe buffer must not block
+    std::string data(1024 * 1024, 'a');
+    data += "end";
+    runTransformCommand("tr a b", data);
+    CHECK_EQUAL(data.size(), 1024 * 1024 + 3)
+    CHECK_EQUAL(data.substr(0, 3), "bbb")
+    CHECK_EQUAL(data.substr(data.size() - 3), "end")
+    // commands may ignore their input
+    std::string ignored(1024 * 1024, 'a');
+    runTransformCommand("echo ok", ignored);
+    CHECK_EQUAL(ignored, "ok\n")
+    std::string failing = "a";
+    CHECK_THROW(runTransformCommand("exit 3", failing), std::runtime_error)
+#endif
+    TEST_SUCCEEDED
+}
+
+static bool test_transform_registry(const stdfs::path &dataDir)
+{
+    CHECK_EQUAL(normalizeTransformExtension("JSON"), ".json")
+    CHECK_EQUAL(normalizeTransformExtension(".Glsl"), ".glsl")
+    CHECK_THROW(createTransform("unknown"), std::runtime_error)
+    CHECK_THROW(createTransform("cmd:"), std::runtime_error)
+    TransformMap transforms;
+    transforms[".txt"].push_back(createTransform("minify-whitespace"));
+    transforms[".txt"].push_back(createTransform("trim-zeros"));
+    CHECK(findTransforms(transforms, "a.png") == nullptr)
+    CHECK(findTransforms(transforms, "noextension") == nullptr)
+    const auto textTransforms = findTransforms(transforms, "dir/A.TXT");
+    CHECK(textTransforms != nullptr)
+    CHECK_EQUAL(textTransforms->size(), 2)
+    // transforms are applied to the file content in order
+    const auto data = transformFile(dataDir / "subdir" / "subdir2" / "test3.txt", *textTransforms);
+    CHECK(!data.empty())
+    CHECK(data.find("\r") == std::string::npos)
+    CHECK_THROW(transformFile(dataDir / "missing.txt", *textTransforms), std::runtime_error)
+    TEST_SUCCEEDED
+}
+
+START_SUITE("Input transforms")
+const stdfs::path dataDir = stdfs::current_path() / "../../test/data/";
+RUN_TEST("Whitespace minification", test_transform_whitespace())
+RUN_TEST("Zero trimming", test_transform_zeros())
+RUN_TEST("PNG metadata", test_transform_png(dataDir))
+RUN_TEST("Commands", test_transform_command())
+RUN_TEST("Registry", test_transform_registry(dataDir))
+END_SUITE